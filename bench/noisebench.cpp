@@ -0,0 +1,452 @@
+// Microbenchmarks and sanity checks for the math in noise.cpp.
+// It needs nothing but the standard library, so it builds anywhere; from the repo root:
+//
+//     g++ -std=c++20 -O2 -pthread -I. bench/noisebench.cpp noise.cpp -o noisebench
+//     ./noisebench [max threads]
+//
+// Every benchmark prints ns/sample and samples/sec, and the multithreaded ones do it
+// for 1 to N threads. The checks at the end print PASS or FAIL, and any FAIL makes
+// the exit code non-zero.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "noise.h"
+#include "simd.h"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr static size_t SAMPLES = 1 << 20;
+
+// Keeps the optimizer from deciding the work was pointless.
+static std::atomic<double> sink = 0.0;
+
+struct Inputs {
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> zs;
+};
+
+// Spread out roughly like the emotion lookups: a couple of screens' worth, drifting through time.
+static Inputs make_inputs(size_t n, uint64_t seed) {
+	Random rng(seed);
+	Inputs inputs = { std::vector<float>(n), std::vector<float>(n), std::vector<float>(n) };
+
+	for (size_t i = 0; i < n; i++) {
+		inputs.zs[i] = (float) (rng.uniform() * 500.0);
+		inputs.xs[i] = (float) (rng.uniform() * 2.4 - 1.2) + inputs.zs[i];
+		inputs.ys[i] = (float) (rng.uniform() * 2.4 - 1.2) + inputs.zs[i];
+	}
+
+	return inputs;
+}
+
+static void report(const std::string &name, int threads, size_t samples, Clock::duration elapsed) {
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	double per_sample = ns / samples;
+	double per_second = samples / (ns / 1e9);
+
+	std::printf("  %-36s %2d thread%s  %9.2f ns/sample  %12.0f samples/sec\n",
+		name.c_str(), threads, threads == 1 ? " " : "s", per_sample, per_second);
+}
+
+// Runs work(thread index, first sample, sample count) split evenly across the threads,
+// and reports the wall time for all of them.
+static void run(const std::string &name, int threads, size_t samples, const std::function<void(int, size_t, size_t)> &work) {
+	std::vector<std::thread> workers;
+	size_t chunk = samples / threads;
+
+	auto start = Clock::now();
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back(work, t, t * chunk, chunk);
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+
+	report(name, threads, chunk * threads, Clock::now() - start);
+}
+
+static std::vector<int> thread_counts(int max_threads) {
+	std::vector<int> counts;
+	for (int t = 1; t < max_threads; t *= 2) {
+		counts.push_back(t);
+	}
+	counts.push_back(max_threads);
+
+	return counts;
+}
+
+static void bench_noise(int max_threads) {
+	std::printf("noise\n");
+
+	Inputs in = make_inputs(SAMPLES, 1);
+	std::vector<float> out(SAMPLES);
+
+	for (int threads : thread_counts(max_threads)) {
+		run("PerlinNoise::get", threads, SAMPLES / 4, [&](int, size_t first, size_t count) {
+			double sum = 0.0;
+			for (size_t i = first; i < first + count; i++) {
+				sum += PerlinNoise::get(in.xs[i], in.ys[i], in.zs[i]);
+			}
+			sink = sink + sum;
+		});
+	}
+
+	for (int threads : thread_counts(max_threads)) {
+		run("PerlinNoise::get_gradient<double>", threads, SAMPLES / 4, [&](int, size_t first, size_t count) {
+			double sum = 0.0;
+			for (size_t i = first; i < first + count; i++) {
+				sum += PerlinNoise::get_gradient<double>(in.xs[i], in.ys[i], in.zs[i]).dx;
+			}
+			sink = sink + sum;
+		});
+	}
+
+	for (int threads : thread_counts(max_threads)) {
+		run("PerlinNoise::get_gradient<float>", threads, SAMPLES / 4, [&](int, size_t first, size_t count) {
+			float sum = 0.0f;
+			for (size_t i = first; i < first + count; i++) {
+				sum += PerlinNoise::get_gradient<float>(in.xs[i], in.ys[i], in.zs[i]).dx;
+			}
+			sink = sink + sum;
+		});
+	}
+
+	for (int threads : thread_counts(max_threads)) {
+		run("PerlinNoise::get_many", threads, SAMPLES, [&](int, size_t first, size_t count) {
+			PerlinNoise::get_many(&in.xs[first], &in.ys[first], &in.zs[first], &out[first], count);
+		});
+	}
+
+	for (int threads : thread_counts(max_threads)) {
+		run("SimplexNoise::get", threads, SAMPLES / 4, [&](int, size_t first, size_t count) {
+			double sum = 0.0;
+			for (size_t i = first; i < first + count; i++) {
+				sum += SimplexNoise::get(in.xs[i], in.ys[i], in.zs[i]);
+			}
+			sink = sink + sum;
+		});
+	}
+
+	for (int threads : thread_counts(max_threads)) {
+		run("SimplexNoise::get_many", threads, SAMPLES, [&](int, size_t first, size_t count) {
+			SimplexNoise::get_many(&in.xs[first], &in.ys[first], &in.zs[first], &out[first], count);
+		});
+	}
+
+	const NoiseVolume volume(64);
+	for (int threads : thread_counts(max_threads)) {
+		run("NoiseVolume::get_many (64^3)", threads, SAMPLES, [&](int, size_t first, size_t count) {
+			volume.get_many(&in.xs[first], &in.ys[first], &in.zs[first], &out[first], count);
+		});
+	}
+}
+
+static void bench_random(int max_threads) {
+	std::printf("random\n");
+
+	Random rng(1);
+
+	run("Noise::random", 1, SAMPLES, [&](int, size_t, size_t count) {
+		double sum = 0.0;
+		for (size_t i = 0; i < count; i++) {
+			sum += Noise::random(rng);
+		}
+		sink = sink + sum;
+	});
+
+	run("Noise::wiggle", 1, SAMPLES, [&](int, size_t, size_t count) {
+		double value = 0.0;
+		for (size_t i = 0; i < count; i++) {
+			value = Noise::wiggle(rng, value, -0.3, 0.3, 0.01);
+		}
+		sink = sink + value;
+	});
+
+	// The streams aren't thread-safe, so every thread gets its own split.
+	std::vector<Random> streams;
+	Random root(2);
+	for (int t = 0; t < max_threads; t++) {
+		streams.push_back(root.split());
+	}
+
+	for (int threads : thread_counts(max_threads)) {
+		run("Random::uniform", threads, SAMPLES * 4, [&](int t, size_t, size_t count) {
+			Random rng = streams[t];
+			double sum = 0.0;
+			for (size_t i = 0; i < count; i++) {
+				sum += rng.uniform();
+			}
+			sink = sink + sum;
+		});
+	}
+
+	std::vector<double> draws(SAMPLES * 2);
+	for (int threads : thread_counts(max_threads)) {
+		run("Random::fill", threads, draws.size(), [&](int t, size_t first, size_t count) {
+			Random rng = streams[t];
+			rng.fill(&draws[first], count);
+		});
+	}
+
+	std::vector<double> values(SAMPLES, 0.0);
+	std::vector<double> steps(SAMPLES, 0.01);
+	for (int threads : thread_counts(max_threads)) {
+		run("Noise::wiggle_many", threads, SAMPLES, [&](int, size_t first, size_t count) {
+			Noise::wiggle_many(&values[first], &steps[first], &draws[first], &draws[SAMPLES + first], 0.3, count);
+		});
+	}
+}
+
+static int failures = 0;
+
+static void check(const std::string &name, bool passed, const std::string &detail) {
+	std::printf("  %s  %-44s %s\n", passed ? "PASS" : "FAIL", name.c_str(), detail.c_str());
+	failures += passed ? 0 : 1;
+}
+
+static std::string format(const char *format, double a, double b = 0.0) {
+	char buffer[128];
+	std::snprintf(buffer, sizeof buffer, format, a, b);
+	return buffer;
+}
+
+static void check_noise() {
+	std::printf("noise quality\n");
+
+	Inputs in = make_inputs(SAMPLES, 3);
+	std::vector<float> batch(SAMPLES);
+	PerlinNoise::get_many(in.xs.data(), in.ys.data(), in.zs.data(), batch.data(), SAMPLES);
+
+	double low = 1.0, high = -1.0, sum = 0.0, sum_sq = 0.0, worst_batch = 0.0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		double value = PerlinNoise::get(in.xs[i], in.ys[i], in.zs[i]);
+
+		low = std::min(low, value);
+		high = std::max(high, value);
+		sum += value;
+		sum_sq += value * value;
+		worst_batch = std::max(worst_batch, std::abs(value - batch[i]));
+	}
+
+	double mean = sum / SAMPLES;
+	double deviation = std::sqrt(sum_sq / SAMPLES - mean * mean);
+
+	check("range within [-1, 1]", low >= -1.0 && high <= 1.0, format("[%.4f, %.4f]", low, high));
+	check("mean near 0", std::abs(mean) < 0.01, format("%.5f", mean));
+	check("spread near the emotion tuning (sd ~0.1)", deviation > 0.07 && deviation < 0.13, format("%.4f", deviation));
+	check("get_many agrees with get", worst_batch < 1e-5, format("max diff %.2e", worst_batch));
+
+	// Step across cell boundaries: the value and its slope should carry straight on through.
+	const double h = 1e-5;
+	double worst_jump = 0.0, worst_kink = 0.0, worst_gradient = 0.0;
+	Random rng(4);
+	for (int i = 0; i < 100000; i++) {
+		double x = std::floor(rng.uniform() * 512.0 - 256.0);
+		double y = rng.uniform() * 512.0 - 256.0;
+		double z = rng.uniform() * 512.0 - 256.0;
+
+		double left = PerlinNoise::get(x - h, y, z);
+		double right = PerlinNoise::get(x + h, y, z);
+		double left_slope = (left - PerlinNoise::get(x - 2 * h, y, z)) / h;
+		double right_slope = (PerlinNoise::get(x + 2 * h, y, z) - right) / h;
+
+		worst_jump = std::max(worst_jump, std::abs(right - left));
+		worst_kink = std::max(worst_kink, std::abs(right_slope - left_slope));
+
+		double analytic = PerlinNoise::get_gradient(x + h, y, z).dx;
+		worst_gradient = std::max(worst_gradient, std::abs(analytic - (right - left) / (2 * h)));
+	}
+
+	check("continuous across cell boundaries", worst_jump < 1e-4, format("max jump %.2e", worst_jump));
+	check("slope continuous across cell boundaries", worst_kink < 1e-3, format("max kink %.2e", worst_kink));
+	check("get_gradient matches finite differences", worst_gradient < 1e-3, format("max diff %.2e", worst_gradient));
+
+	// The float build should land where the double one does, give or take what a float can hold.
+	double worst_precision = 0.0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		auto single = PerlinNoise::get_gradient<float>(in.xs[i], in.ys[i], in.zs[i]);
+		auto reference = PerlinNoise::get_gradient<double>(in.xs[i], in.ys[i], in.zs[i]);
+
+		worst_precision = std::max(worst_precision, std::abs(single.value - reference.value));
+		worst_precision = std::max(worst_precision, std::abs(single.dx - reference.dx));
+		worst_precision = std::max(worst_precision, std::abs(single.dy - reference.dy));
+	}
+
+	check("get_gradient<float> tracks <double>", worst_precision < 1e-5, format("max diff %.2e", worst_precision));
+
+	// Simplex should be interchangeable with Perlin as far as the Yonkers can tell.
+	SimplexNoise::get_many(in.xs.data(), in.ys.data(), in.zs.data(), batch.data(), SAMPLES);
+
+	low = 1.0, high = -1.0, sum = 0.0, sum_sq = 0.0, worst_batch = 0.0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		double value = SimplexNoise::get(in.xs[i], in.ys[i], in.zs[i]);
+
+		low = std::min(low, value);
+		high = std::max(high, value);
+		sum += value;
+		sum_sq += value * value;
+		worst_batch = std::max(worst_batch, std::abs(value - batch[i]));
+	}
+
+	mean = sum / SAMPLES;
+	deviation = std::sqrt(sum_sq / SAMPLES - mean * mean);
+
+	check("simplex range within [-1, 1]", low >= -1.0 && high <= 1.0, format("[%.4f, %.4f]", low, high));
+	check("simplex mean near 0", std::abs(mean) < 0.01, format("%.5f", mean));
+	check("simplex spread matches Perlin (sd ~0.1)", deviation > 0.07 && deviation < 0.13, format("%.4f", deviation));
+	// Skewing a float a few hundred cells out costs it a few ulps, so this one's looser.
+	check("simplex get_many agrees with get", worst_batch < 5e-4, format("max diff %.2e", worst_batch));
+
+	worst_jump = 0.0;
+	for (int i = 0; i < 100000; i++) {
+		double x = rng.uniform() * 512.0 - 256.0;
+		double y = rng.uniform() * 512.0 - 256.0;
+		double z = rng.uniform() * 512.0 - 256.0;
+
+		worst_jump = std::max(worst_jump, std::abs(SimplexNoise::get(x + h, y, z) - SimplexNoise::get(x - h, y, z)));
+	}
+
+	check("simplex continuous", worst_jump < 1e-4, format("max jump %.2e", worst_jump));
+
+	// The volume is the noise that repeats every size / SamplesPerCell cells, so that's what it's held to.
+	// Its trilinear lerp between samples is all the error it should have: with 4 samples a cell that's
+	// about a tenth of the spread on average, where a volume baked wrong would be off by the whole of it.
+	const NoiseVolume volume(64);
+	const int period = 64 / NoiseVolume::SamplesPerCell;
+	volume.get_many(in.xs.data(), in.ys.data(), in.zs.data(), batch.data(), SAMPLES);
+
+	double worst_volume = 0.0, volume_error = 0.0;
+	worst_batch = 0.0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		double error = std::abs(PerlinNoise::get_periodic(in.xs[i], in.ys[i], in.zs[i], period) - batch[i]);
+
+		worst_volume = std::max(worst_volume, error);
+		volume_error += error;
+		worst_batch = std::max(worst_batch, (double) std::abs(volume.get(in.xs[i], in.ys[i], in.zs[i]) - batch[i]));
+	}
+
+	check("volume tracks Perlin (max)", worst_volume < 0.08, format("max error %.2e", worst_volume));
+	check("volume tracks Perlin (mean)", volume_error / SAMPLES < 0.015, format("mean error %.2e", volume_error / SAMPLES));
+	check("volume get_many agrees with get", worst_batch < 1e-5, format("max diff %.2e", worst_batch));
+}
+
+static void check_random() {
+	std::printf("random quality\n");
+
+	Random rng(5);
+	constexpr int BUCKETS = 16;
+	std::vector<size_t> buckets(BUCKETS, 0);
+	double low = 1.0, high = 0.0, sum = 0.0, sum_sq = 0.0;
+
+	for (size_t i = 0; i < SAMPLES; i++) {
+		double value = rng.uniform();
+
+		low = std::min(low, value);
+		high = std::max(high, value);
+		sum += value;
+		sum_sq += value * value;
+		buckets[(size_t) (value * BUCKETS)]++;
+	}
+
+	double mean = sum / SAMPLES;
+	double variance = sum_sq / SAMPLES - mean * mean;
+
+	double expected = (double) SAMPLES / BUCKETS;
+	double chi_squared = 0.0;
+	for (size_t count : buckets) {
+		chi_squared += (count - expected) * (count - expected) / expected;
+	}
+
+	check("uniform() within [0, 1)", low >= 0.0 && high < 1.0, format("[%.6f, %.6f]", low, high));
+	check("mean near 1/2", std::abs(mean - 0.5) < 0.002, format("%.5f", mean));
+	check("variance near 1/12", std::abs(variance - 1.0 / 12.0) < 0.001, format("%.5f", variance));
+	// 15 degrees of freedom; 37.7 is the 0.1% tail.
+	check("buckets evenly filled", chi_squared < 37.7, format("chi^2 = %.2f", chi_squared));
+
+	Random a(6);
+	Random b = a.split();
+	size_t same = 0;
+	for (int i = 0; i < 1000; i++) {
+		same += a.next() == b.next() ? 1 : 0;
+	}
+	check("split streams differ", same == 0, format("%.0f collisions", (double) same));
+
+	Random wiggles(7);
+	double value = 0.0, worst = 0.0, drift = 0.0;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		value = Noise::wiggle(wiggles, value, -0.3, 0.3, 0.05);
+		worst = std::max(worst, std::abs(value));
+		drift += value;
+	}
+	check("wiggle stays between min and max", worst <= 0.3, format("max |value| %.4f", worst));
+	check("wiggle hovers around the middle", std::abs(drift / SAMPLES) < 0.02, format("mean %.5f", drift / SAMPLES));
+
+	// Every wiggle_many path, fed the draws wiggle() would have made, has to land exactly where it does.
+	const double limit = 0.3;
+	std::vector<double> bases(SAMPLES), steps(SAMPLES), coins(SAMPLES), amounts(SAMPLES), reference(SAMPLES);
+	Random draws(8);
+	for (size_t i = 0; i < SAMPLES; i++) {
+		bases[i] = (draws.uniform() * 2.0 - 1.0) * limit;
+		steps[i] = draws.uniform() * 0.1;
+	}
+
+	Random replay = draws;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		coins[i] = Noise::random(draws);
+		amounts[i] = Noise::random(draws);
+		reference[i] = Noise::wiggle(replay, bases[i], -limit, limit, steps[i]);
+	}
+
+	const std::pair<SimdLevel, const char *> levels[] = {
+		{ SimdLevel::Scalar, "scalar" },
+		{ SimdLevel::SSE41, "SSE4.1" },
+		{ SimdLevel::AVX2, "AVX2" },
+	};
+
+	for (auto [level, name] : levels) {
+		if (level > simd_level()) {
+			std::printf("  SKIP  wiggle_many (%s) isn't supported here\n", name);
+			continue;
+		}
+
+		std::vector<double> values = bases;
+		Noise::wiggle_many(level, values.data(), steps.data(), coins.data(), amounts.data(), limit, SAMPLES);
+
+		// The steps should go up half the time, and cover on average half the room there was.
+		double worst_diff = 0.0, ups = 0.0, reach = 0.0;
+		for (size_t i = 0; i < SAMPLES; i++) {
+			double room = values[i] > bases[i] ? limit - bases[i] : bases[i] + limit;
+
+			worst_diff = std::max(worst_diff, std::abs(values[i] - reference[i]));
+			ups += values[i] > bases[i] ? 1.0 : 0.0;
+			reach += steps[i] > 0.0 ? std::abs(values[i] - bases[i]) / (room * steps[i]) : 0.5;
+		}
+
+		std::string label = std::string("wiggle_many (") + name + ")";
+		check(label + " agrees with wiggle", worst_diff < 1e-12, format("max diff %.2e", worst_diff));
+		check(label + " goes up half the time", std::abs(ups / SAMPLES - 0.5) < 0.003, format("%.5f", ups / SAMPLES));
+		check(label + " steps half the room", std::abs(reach / SAMPLES - 0.5) < 0.002, format("mean %.5f", reach / SAMPLES));
+	}
+}
+
+int main(int argc, char **argv) {
+	int max_threads = argc > 1 ? std::atoi(argv[1]) : (int) std::thread::hardware_concurrency();
+	max_threads = std::max(max_threads, 1);
+
+	bench_noise(max_threads);
+	bench_random(max_threads);
+	check_noise();
+	check_random();
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+// How the spatial indexes the patterns lean on hold up as the crowd grows, against
+// just checking everyone against everyone. It needs nothing but the standard library,
+// so it builds anywhere; from the repo root:
+//
+//     g++ -std=c++20 -O2 -I. bench/spatialbench.cpp grid.cpp quadtree.cpp noise.cpp -o spatialbench
+//     ./spatialbench [max points]
+//
+// For the grid, every size gets a radius that puts about NEIGHBOURS others around each
+// point, the way Flock's radius shrinks as SpriteCount grows, so a good index should
+// cost about the same per point at every size. For the quadtree, everyone pulls on
+// everyone, bunched up the way Orbit's crowd ends up, so it should cost about log n
+// per point, against n for adding up every pair. All-pairs stops at BRUTE_FORCE_LIMIT
+// points, past which it's just waiting. The checks at the end print PASS or FAIL, and
+// any FAIL makes the exit code non-zero.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grid.h"
+#include "noise.h"
+#include "quadtree.h"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr static double NEIGHBOURS = 30.0;
+constexpr static size_t BRUTE_FORCE_LIMIT = 16384;
+// What Orbit uses.
+constexpr static Real OPENING_ANGLE = Real(0.5);
+constexpr static Real SOFTENING = Real(0.08);
+
+// Keeps the optimizer from deciding the work was pointless.
+static std::atomic<size_t> sink = 0;
+
+struct Points {
+	std::vector<Real> xs;
+	std::vector<Real> ys;
+};
+
+// Spread evenly over the screen, [-1, 1] both ways.
+static Points make_points(size_t n, uint64_t seed) {
+	Random rng(seed);
+	Points points = { std::vector<Real>(n), std::vector<Real>(n) };
+
+	for (size_t i = 0; i < n; i++) {
+		points.xs[i] = (Real) (rng.uniform() * 2.0 - 1.0);
+		points.ys[i] = (Real) (rng.uniform() * 2.0 - 1.0);
+	}
+
+	return points;
+}
+
+// Bunched up into a few tight knots, like a flock that's found itself.
+static Points make_clusters(size_t n, uint64_t seed) {
+	Random rng(seed);
+	Points points = { std::vector<Real>(n), std::vector<Real>(n) };
+
+	for (size_t i = 0; i < n; i++) {
+		double centre = (double) (i % 4) * 0.5 - 0.75;
+		points.xs[i] = (Real) (centre + (rng.uniform() - 0.5) * 0.05);
+		points.ys[i] = (Real) (-centre + (rng.uniform() - 0.5) * 0.05);
+	}
+
+	return points;
+}
+
+static Real radius_for(size_t n) {
+	return (Real) std::sqrt(NEIGHBOURS * 4.0 / (3.14159265358979 * (double) n));
+}
+
+static double microseconds(Clock::duration elapsed) {
+	return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1000.0;
+}
+
+// How many others are within radius of each point, through the grid.
+static std::vector<size_t> grid_counts(UniformGrid &grid, const Points &points, Real radius) {
+	size_t n = points.xs.size();
+	Real radius_sq = radius * radius;
+
+	grid.build(n, radius, radius, [&](size_t i) {
+		return std::pair(points.xs[i], points.ys[i]);
+	});
+
+	std::vector<size_t> counts(n, 0);
+	for (size_t a = 0; a < n; a++) {
+		grid.visit_near(grid.x(a), grid.y(a), [&](size_t b, Real bx, Real by) {
+			Real dist_x = bx - grid.x(a);
+			Real dist_y = by - grid.y(a);
+			counts[a] += b != a && dist_x * dist_x + dist_y * dist_y < radius_sq ? 1 : 0;
+		});
+	}
+
+	return counts;
+}
+
+// The same, the slow way.
+static std::vector<size_t> brute_force_counts(const Points &points, Real radius) {
+	size_t n = points.xs.size();
+	Real radius_sq = radius * radius;
+
+	std::vector<size_t> counts(n, 0);
+	for (size_t a = 0; a < n; a++) {
+		for (size_t b = 0; b < n; b++) {
+			Real dist_x = points.xs[b] - points.xs[a];
+			Real dist_y = points.ys[b] - points.ys[a];
+			counts[a] += b != a && dist_x * dist_x + dist_y * dist_y < radius_sq ? 1 : 0;
+		}
+	}
+
+	return counts;
+}
+
+// Everyone's pull on everyone, through the tree.
+static std::vector<QuadTree::Pull> tree_pulls(QuadTree &tree, const Points &points, Real opening_angle) {
+	size_t n = points.xs.size();
+
+	tree.build(n, [&](size_t i) {
+		return std::pair(points.xs[i], points.ys[i]);
+	});
+
+	std::vector<QuadTree::Pull> pulls(n);
+	for (size_t i = 0; i < n; i++) {
+		pulls[i] = tree.pull(tree.x(i), tree.y(i), opening_angle, SOFTENING);
+	}
+
+	return pulls;
+}
+
+// The same, adding up every pair, in doubles so it can be the yardstick.
+static std::vector<QuadTree::Pull> brute_force_pulls(const Points &points) {
+	size_t n = points.xs.size();
+	double softening_sq = (double) SOFTENING * SOFTENING;
+
+	std::vector<QuadTree::Pull> pulls(n);
+	for (size_t a = 0; a < n; a++) {
+		double pull_x = 0, pull_y = 0;
+		for (size_t b = 0; b < n; b++) {
+			double dist_x = (double) points.xs[b] - points.xs[a];
+			double dist_y = (double) points.ys[b] - points.ys[a];
+			double dist_sq = dist_x * dist_x + dist_y * dist_y + softening_sq;
+			double strength = 1.0 / (dist_sq * std::sqrt(dist_sq));
+			pull_x += dist_x * strength;
+			pull_y += dist_y * strength;
+		}
+		pulls[a] = { (Real) pull_x, (Real) pull_y };
+	}
+
+	return pulls;
+}
+
+// How far off the tree is, as a share of how hard the pull is, averaged over everyone.
+static double pull_error(const std::vector<QuadTree::Pull> &pulls, const std::vector<QuadTree::Pull> &exact) {
+	double error = 0.0, total = 0.0;
+	for (size_t i = 0; i < pulls.size(); i++) {
+		error += std::hypot((double) pulls[i].x - exact[i].x, (double) pulls[i].y - exact[i].y);
+		total += std::hypot((double) exact[i].x, (double) exact[i].y);
+	}
+
+	return total > 0 ? error / total : 0.0;
+}
+
+static void bench_grid(size_t max_points) {
+	std::printf("UniformGrid, ~%.0f neighbours each\n", NEIGHBOURS);
+	std::printf("  %8s  %10s  %10s  %10s  %12s  %8s\n", "points", "build us", "query us", "ns/point", "all-pairs us", "speedup");
+
+	UniformGrid grid;
+	for (size_t n = 1024; n <= max_points; n *= 2) {
+		Points points = make_points(n, n);
+		Real radius = radius_for(n);
+		Real radius_sq = radius * radius;
+
+		// Once to warm up, so the timed build is the steady state where the memory's already there.
+		sink += grid_counts(grid, points, radius)[0];
+
+		auto start = Clock::now();
+		grid.build(n, radius, radius, [&](size_t i) {
+			return std::pair(points.xs[i], points.ys[i]);
+		});
+		auto built = Clock::now();
+
+		size_t found = 0;
+		for (size_t a = 0; a < n; a++) {
+			grid.visit_near(grid.x(a), grid.y(a), [&](size_t b, Real bx, Real by) {
+				Real dist_x = bx - grid.x(a);
+				Real dist_y = by - grid.y(a);
+				found += dist_x * dist_x + dist_y * dist_y < radius_sq ? 1 : 0;
+			});
+		}
+		auto queried = Clock::now();
+		sink += found;
+
+		double build_us = microseconds(built - start);
+		double query_us = microseconds(queried - built);
+		double per_point = (build_us + query_us) * 1000.0 / n;
+
+		if (n <= BRUTE_FORCE_LIMIT) {
+			auto brute_start = Clock::now();
+			sink += brute_force_counts(points, radius)[0];
+			double brute_us = microseconds(Clock::now() - brute_start);
+
+			std::printf("  %8zu  %10.1f  %10.1f  %10.1f  %12.1f  %7.1fx\n", n, build_us, query_us, per_point, brute_us, brute_us / (build_us + query_us));
+		} else {
+			std::printf("  %8zu  %10.1f  %10.1f  %10.1f  %12s  %8s\n", n, build_us, query_us, per_point, "-", "-");
+		}
+	}
+}
+
+static void bench_quadtree(size_t max_points) {
+	std::printf("QuadTree, opening angle %.2f\n", (double) OPENING_ANGLE);
+	std::printf("  %8s  %10s  %10s  %10s  %12s  %8s  %8s\n", "points", "build us", "pull us", "ns/point", "all-pairs us", "speedup", "error");
+
+	QuadTree tree;
+	for (size_t n = 1024; n <= max_points; n *= 2) {
+		Points points = make_clusters(n, n);
+
+		// Once to warm up, so the timed build is the steady state where the nodes are already there.
+		sink += (size_t) tree_pulls(tree, points, OPENING_ANGLE)[0].x;
+
+		auto start = Clock::now();
+		tree.build(n, [&](size_t i) {
+			return std::pair(points.xs[i], points.ys[i]);
+		});
+		auto built = Clock::now();
+
+		std::vector<QuadTree::Pull> pulls(n);
+		for (size_t i = 0; i < n; i++) {
+			pulls[i] = tree.pull(tree.x(i), tree.y(i), OPENING_ANGLE, SOFTENING);
+		}
+		auto pulled = Clock::now();
+
+		double build_us = microseconds(built - start);
+		double pull_us = microseconds(pulled - built);
+		double per_point = (build_us + pull_us) * 1000.0 / n;
+
+		if (n <= BRUTE_FORCE_LIMIT) {
+			auto brute_start = Clock::now();
+			std::vector<QuadTree::Pull> exact = brute_force_pulls(points);
+			double brute_us = microseconds(Clock::now() - brute_start);
+
+			std::printf("  %8zu  %10.1f  %10.1f  %10.1f  %12.1f  %7.1fx  %7.3f%%\n", n, build_us, pull_us, per_point, brute_us,
+				brute_us / (build_us + pull_us), pull_error(pulls, exact) * 100.0);
+		} else {
+			std::printf("  %8zu  %10.1f  %10.1f  %10.1f  %12s  %8s  %8s\n", n, build_us, pull_us, per_point, "-", "-", "-");
+		}
+	}
+}
+
+static int failures = 0;
+
+static void check(const std::string &name, bool passed, const std::string &detail) {
+	std::printf("  %s  %-44s %s\n", passed ? "PASS" : "FAIL", name.c_str(), detail.c_str());
+	failures += passed ? 0 : 1;
+}
+
+static std::string format(const char *format, double a, double b = 0.0) {
+	char buffer[128];
+	std::snprintf(buffer, sizeof buffer, format, a, b);
+	return buffer;
+}
+
+static size_t mismatches(const std::vector<size_t> &a, const std::vector<size_t> &b) {
+	size_t wrong = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		wrong += a[i] != b[i] ? 1 : 0;
+	}
+
+	return wrong;
+}
+
+static void check_grid() {
+	std::printf("UniformGrid correctness\n");
+
+	UniformGrid grid;
+
+	Points spread = make_points(4096, 1);
+	size_t wrong = mismatches(grid_counts(grid, spread, radius_for(4096)), brute_force_counts(spread, radius_for(4096)));
+	check("finds what all-pairs finds, spread out", wrong == 0, format("%.0f points differ", (double) wrong));
+
+	Points clusters = make_clusters(4096, 2);
+	wrong = mismatches(grid_counts(grid, clusters, Real(0.02)), brute_force_counts(clusters, Real(0.02)));
+	check("finds what all-pairs finds, bunched up", wrong == 0, format("%.0f points differ", (double) wrong));
+
+	// A radius far smaller than the gaps would ask for more cells than there are points.
+	wrong = mismatches(grid_counts(grid, spread, Real(1e-4)), brute_force_counts(spread, Real(1e-4)));
+	check("finds what all-pairs finds, tiny radius", wrong == 0, format("%.0f points differ", (double) wrong));
+
+	// Going from many points down to a handful has to let go of the old cells.
+	Points few = make_points(7, 3);
+	wrong = mismatches(grid_counts(grid, few, Real(0.5)), brute_force_counts(few, Real(0.5)));
+	check("rebuilding smaller starts clean", wrong == 0, format("%.0f points differ", (double) wrong));
+
+	// Anyone who isn't anywhere still gets put somewhere, and nobody else gets lost over it.
+	Points broken = make_points(256, 4);
+	broken.xs[10] = std::nan("");
+	broken.ys[20] = (Real) 1e30;
+	auto counts = grid_counts(grid, broken, Real(0.2));
+	auto expected = brute_force_counts(broken, Real(0.2));
+	wrong = mismatches(counts, expected);
+	check("copes with NaN and far-off points", wrong == 0, format("%.0f points differ", (double) wrong));
+
+	// The same points visit in the same order, every build.
+	std::vector<size_t> first_order, second_order;
+	for (std::vector<size_t> *order : { &first_order, &second_order }) {
+		grid.build(spread.xs.size(), Real(0.05), Real(0.05), [&](size_t i) {
+			return std::pair(spread.xs[i], spread.ys[i]);
+		});
+		for (size_t a = 0; a < 64; a++) {
+			grid.visit_near(grid.x(a), grid.y(a), [&](size_t b, Real, Real) {
+				order->push_back(b);
+			});
+		}
+	}
+	check("visit order repeats exactly", first_order == second_order, format("%.0f visits", (double) first_order.size()));
+}
+
+static void check_quadtree() {
+	std::printf("QuadTree correctness\n");
+
+	QuadTree tree;
+
+	Points spread = make_points(2048, 5);
+	std::vector<QuadTree::Pull> exact = brute_force_pulls(spread);
+	double error = pull_error(tree_pulls(tree, spread, 0), exact);
+	check("opening angle 0 adds up every pair", error < 1e-5, format("error %.2e", error));
+
+	// Spread out evenly, the pulls from either side nearly cancel, so what's left over is small
+	// next to the pieces' own error; bunched up, there's a clear pull and the error shrinks.
+	error = pull_error(tree_pulls(tree, spread, OPENING_ANGLE), exact);
+	check("Orbit's opening angle stays close", error < 0.02, format("error %.4f%%", error * 100.0));
+
+	Points clusters = make_clusters(2048, 6);
+	error = pull_error(tree_pulls(tree, clusters, OPENING_ANGLE), brute_force_pulls(clusters));
+	check("Orbit's opening angle stays close, bunched up", error < 0.01, format("error %.4f%%", error * 100.0));
+
+	// Everyone in one spot can never be split apart; it has to stop somewhere, and pull on nobody.
+	Points pile = { std::vector<Real>(100, Real(0.25)), std::vector<Real>(100, Real(-0.5)) };
+	std::vector<QuadTree::Pull> pile_pulls = tree_pulls(tree, pile, OPENING_ANGLE);
+	double worst = 0.0;
+	for (const QuadTree::Pull &pull : pile_pulls) {
+		worst = std::max(worst, std::hypot((double) pull.x, (double) pull.y));
+	}
+	check("copes with everyone in one spot", worst == 0.0, format("max pull %.2e", worst));
+
+	// Anyone who isn't anywhere is left out, and everyone else is pulled as if they weren't there.
+	Points broken = make_points(256, 7);
+	Points mended = broken;
+	mended.xs.erase(mended.xs.begin() + 10);
+	mended.ys.erase(mended.ys.begin() + 10);
+	broken.xs[10] = std::nan("");
+	std::vector<QuadTree::Pull> broken_pulls = tree_pulls(tree, broken, 0);
+	std::vector<QuadTree::Pull> mended_exact = brute_force_pulls(mended);
+	broken_pulls.erase(broken_pulls.begin() + 10);
+	error = pull_error(broken_pulls, mended_exact);
+	check("leaves out NaN points", error < 1e-5, format("error %.2e", error));
+
+	// Building the same points twice, with something else in between, lands on the same bits.
+	std::vector<QuadTree::Pull> first = tree_pulls(tree, clusters, OPENING_ANGLE);
+	tree_pulls(tree, spread, OPENING_ANGLE);
+	std::vector<QuadTree::Pull> second = tree_pulls(tree, clusters, OPENING_ANGLE);
+	size_t differ = 0;
+	for (size_t i = 0; i < first.size(); i++) {
+		differ += first[i].x != second[i].x || first[i].y != second[i].y ? 1 : 0;
+	}
+	check("rebuilding repeats exactly", differ == 0, format("%.0f points differ", (double) differ));
+}
+
+int main(int argc, char **argv) {
+	size_t max_points = argc > 1 ? (size_t) std::atoll(argv[1]) : 65536;
+	max_points = std::max(max_points, (size_t) 1024);
+
+	bench_grid(max_points);
+	bench_quadtree(max_points);
+	check_grid();
+	check_quadtree();
+
+	return failures == 0 ? 0 : 1;
+}
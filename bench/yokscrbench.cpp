@@ -0,0 +1,377 @@
+// Runs the whole simulation with no window and nothing to draw on, so it can be
+// timed and profiled anywhere (perf, valgrind, ...). From the repo root:
+//
+//     g++ -std=c++20 -O2 -pthread -DYOK_HEADLESS -I. -o yokscr-bench bench/yokscrbench.cpp
+//         simulation.cpp sprite.cpp spritecontrol.cpp graphics.cpp bitmaps.cpp palettes.cpp
+//         config.cpp context.cpp noise.cpp workers.cpp recording.cpp snapshot.cpp grid.cpp
+//         quadtree.cpp fluid.cpp
+//     ./yokscr-bench --pattern Eddies --sprites 200 --frames 2000
+//
+// It prints how long each stage of a step took, in total and per frame, and a checksum
+// of where everyone ended up. The same settings and seed always give the same checksum,
+// whatever the thread count; if a change moves it, the change moved the sprites.
+//
+// --record writes every step to a file, and --replay plays one back instead of
+// simulating, which is all drawing costs past the simulation. Replaying as many frames
+// as were recorded lands on the same checksum as recording them did.
+//
+// --snapshot keeps where the run ended up, and --resume starts from there, so a run can
+// begin warmed up, mid-pattern. Resuming and running M more frames lands on the same
+// checksum as running all N + M in one go.
+//
+// --scenes runs that many simulations at once, each on a thread of its own with its own
+// context, the way one screensaver per monitor would. They share nothing but cfg, so
+// every one of them lands on the same checksum that one alone would.
+//
+// Options (all optional):
+//     --pattern NAME|N      which pattern to hold for the whole run (default Roamers)
+//     --sprites N           SpriteCount (default 80)
+//     --frames N            how many simulation steps to run (default 1000)
+//     --trail-length N      TrailLength; 0 turns trails off (default 0)
+//     --trail-space N       TrailSpace (default 10)
+//     --seed N              Seed (default 1)
+//     --threads N           UpdateThreads; 0 is one per core (default 1)
+//     --noise NAME|N        EmotionNoise: perlin, volume or simplex (default perlin)
+//     --size WxH            how big the screen would be (default 1920x1080)
+//     --record FILE         write every step to FILE
+//     --replay FILE         play FILE back rather than simulating; the sprites come
+//                           from the recording, so --sprites and --seed do nothing
+//     --resume FILE         start from a snapshot; use the same settings it was taken with
+//     --snapshot FILE       write a snapshot of how things ended up to FILE
+//     --scenes N            how many simulations to run side by side; stages are
+//                           timed for the first (default 1)
+//     --flock-radius R      FlockRadius, how many starting gaps Flock sprites
+//                           can see across (default 3)
+//     --opening-angle A     OrbitOpeningAngle; 0 adds up every pair (default 0.5)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "context.h"
+#include "simulation.h"
+#include "snapshot.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Settings {
+	PatternName pattern = Roamers;
+	int sprites = 80;
+	int frames = 1000;
+	int trail_length = 0;
+	int trail_space = 10;
+	uint64_t seed = 1;
+	int threads = 1;
+	NoiseEngine noise = NoiseEngine::Perlin;
+	long width = 1920;
+	long height = 1080;
+	std::string record;
+	std::string replay;
+	std::string resume;
+	std::string snapshot;
+	int scenes = 1;
+	double flock_radius = Cfg::FlockRadius.default_;
+	double opening_angle = Cfg::OrbitOpeningAngle.default_;
+};
+
+// One simulation and the context it runs in.
+struct Instance {
+	std::unique_ptr<Context> ctx;
+	std::unique_ptr<Simulation> simulation;
+};
+
+static const std::vector<std::pair<std::string, PatternName>> pattern_names = {
+	{ "Roamers", Roamers },
+	{ "Waves", Waves },
+	{ "Square", Square },
+	{ "Bouncy", Bouncy },
+	{ "Lissajous", Lissajous },
+	{ "Rose", Rose },
+	{ "Lattice", Lattice },
+	{ "Bubbles", Bubbles },
+	{ "Eddies", Eddies },
+	{ "Flock", Flock },
+	{ "Orbit", Orbit },
+	{ "Currents", Currents },
+};
+
+static const std::vector<std::pair<std::string, NoiseEngine>> noise_names = {
+	{ "perlin", NoiseEngine::Perlin },
+	{ "volume", NoiseEngine::Volume },
+	{ "simplex", NoiseEngine::Simplex },
+};
+
+static bool same_name(const std::string &a, const std::string &b) {
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+		return std::tolower((unsigned char) x) == std::tolower((unsigned char) y);
+	});
+}
+
+// By name (any case), or by number.
+template <typename T> static bool parse_name(const std::string &value, const std::vector<std::pair<std::string, T>> &names, T &out) {
+	for (const auto &[name, named] : names) {
+		if (same_name(name, value)) {
+			out = named;
+			return true;
+		}
+	}
+
+	char *end = nullptr;
+	long n = std::strtol(value.c_str(), &end, 10);
+	if (end != value.c_str() && *end == '\0' && n >= 0 && n < (long) names.size()) {
+		out = (T) n;
+		return true;
+	}
+
+	return false;
+}
+
+template <typename T> static std::string name_of(const std::vector<std::pair<std::string, T>> &names, T value) {
+	for (const auto &[name, named] : names) {
+		if (named == value) {
+			return name;
+		}
+	}
+
+	return std::to_string((int) value);
+}
+
+static void usage(const char *program) {
+	std::fprintf(stderr,
+		"usage: %s [--pattern NAME|N] [--sprites N] [--frames N] [--trail-length N] [--trail-space N]\n"
+		"          [--seed N] [--threads N] [--noise perlin|volume|simplex] [--size WxH]\n"
+		"          [--record FILE] [--replay FILE] [--resume FILE] [--snapshot FILE] [--scenes N]\n"
+		"          [--flock-radius R] [--opening-angle A]\n", program);
+}
+
+static bool parse(int argc, char **argv, Settings &settings) {
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		if (i + 1 >= argc) {
+			std::fprintf(stderr, "%s needs a value\n", option.c_str());
+			return false;
+		}
+		std::string value = argv[++i];
+
+		bool ok = true;
+		if (option == "--pattern") {
+			ok = parse_name(value, pattern_names, settings.pattern);
+		} else if (option == "--sprites") {
+			settings.sprites = std::atoi(value.c_str());
+			ok = settings.sprites > 0;
+		} else if (option == "--frames") {
+			settings.frames = std::atoi(value.c_str());
+			ok = settings.frames > 0;
+		} else if (option == "--trail-length") {
+			settings.trail_length = std::atoi(value.c_str());
+			ok = settings.trail_length >= 0;
+		} else if (option == "--trail-space") {
+			settings.trail_space = std::atoi(value.c_str());
+			ok = settings.trail_space > 0;
+		} else if (option == "--seed") {
+			settings.seed = std::strtoull(value.c_str(), nullptr, 10);
+			ok = settings.seed != 0 && settings.seed <= Cfg::Seed.range.second;
+		} else if (option == "--threads") {
+			settings.threads = std::atoi(value.c_str());
+			ok = settings.threads >= 0 && settings.threads <= Cfg::UpdateThreads.range.second;
+		} else if (option == "--noise") {
+			ok = parse_name(value, noise_names, settings.noise);
+		} else if (option == "--size") {
+			ok = std::sscanf(value.c_str(), "%ldx%ld", &settings.width, &settings.height) == 2 && settings.width > 0 && settings.height > 0;
+		} else if (option == "--record") {
+			settings.record = value;
+		} else if (option == "--replay") {
+			settings.replay = value;
+		} else if (option == "--resume") {
+			settings.resume = value;
+		} else if (option == "--snapshot") {
+			settings.snapshot = value;
+		} else if (option == "--scenes") {
+			settings.scenes = std::atoi(value.c_str());
+			ok = settings.scenes > 0;
+		} else if (option == "--flock-radius") {
+			settings.flock_radius = std::atof(value.c_str());
+			ok = settings.flock_radius >= Cfg::FlockRadius.range.first && settings.flock_radius <= Cfg::FlockRadius.range.second;
+		} else if (option == "--opening-angle") {
+			settings.opening_angle = std::atof(value.c_str());
+			ok = settings.opening_angle >= Cfg::OrbitOpeningAngle.range.first && settings.opening_angle <= Cfg::OrbitOpeningAngle.range.second;
+		} else {
+			std::fprintf(stderr, "unknown option %s\n", option.c_str());
+			return false;
+		}
+
+		if (!ok) {
+			std::fprintf(stderr, "bad value for %s: %s\n", option.c_str(), value.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Everything the scene would otherwise read from the registry.
+static void configure(const Settings &settings) {
+	cfg[Cfg::Pattern] = settings.pattern;
+	cfg[Cfg::IsPatternFixed] = 1.0;
+	cfg[Cfg::SpriteCount] = settings.sprites;
+	cfg[Cfg::TrailsEnabled] = settings.trail_length > 0 ? 1.0 : 0.0;
+	cfg[Cfg::TrailLength] = settings.trail_length;
+	cfg[Cfg::TrailSpace] = settings.trail_space;
+	cfg[Cfg::Seed] = (double) settings.seed;
+	cfg[Cfg::UpdateThreads] = settings.threads;
+	cfg[Cfg::EmotionNoise] = (double) settings.noise;
+	cfg[Cfg::FlockRadius] = settings.flock_radius;
+	cfg[Cfg::OrbitOpeningAngle] = settings.opening_angle;
+}
+
+// FNV-1a over every sprite's final position, bit for bit.
+static uint64_t checksum(Sprites &sprites) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	auto mix = [&](Real value) {
+		unsigned char bytes[sizeof(Real)];
+		std::memcpy(bytes, &value, sizeof(Real));
+		for (unsigned char byte : bytes) {
+			hash = (hash ^ byte) * 0x100000001b3ull;
+		}
+	};
+
+	for (size_t i = 0; i < sprites.size(); i++) {
+		mix(sprites.final<X>(i));
+		mix(sprites.final<Y>(i));
+	}
+
+	return hash;
+}
+
+// Sets up a simulation the way settings says, or says why it couldn't.
+static bool make(const Settings &settings, Instance &instance) {
+	instance.ctx = std::make_unique<Context>(settings.width, settings.height);
+
+	std::unique_ptr<Playback> playback;
+	if (!settings.replay.empty()) {
+		playback = Playback::open(settings.replay);
+		if (!playback) {
+			std::fprintf(stderr, "%s isn't a recording we can play\n", settings.replay.c_str());
+			return false;
+		}
+	}
+
+	instance.simulation = std::make_unique<Simulation>(instance.ctx.get(), std::move(playback));
+
+	if (!settings.resume.empty() && !instance.simulation->restore(Snapshot::read_file(settings.resume))) {
+		std::fprintf(stderr, "can't resume from %s\n", settings.resume.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	Settings settings;
+	if (!parse(argc, argv, settings)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	configure(settings);
+
+	std::vector<Instance> instances(settings.scenes);
+	for (Instance &instance : instances) {
+		if (!make(settings, instance)) {
+			return 1;
+		}
+	}
+
+	// Only the first one gets written down; the rest are there to keep it company.
+	Context &ctx = *instances[0].ctx;
+	Simulation &simulation = *instances[0].simulation;
+
+	if (!settings.record.empty() && !simulation.record(settings.record)) {
+		std::fprintf(stderr, "can't write to %s\n", settings.record.c_str());
+		return 1;
+	}
+
+	auto run = [&](Instance &instance) {
+		for (int frame = 0; frame < settings.frames; frame++) {
+			instance.simulation->step();
+		}
+	};
+
+	Clock::time_point start = Clock::now();
+	std::vector<std::thread> others;
+	for (size_t i = 1; i < instances.size(); i++) {
+		others.emplace_back(run, std::ref(instances[i]));
+	}
+	run(instances[0]);
+	for (std::thread &other : others) {
+		other.join();
+	}
+	double total = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (!settings.snapshot.empty() && !Snapshot::write_file(settings.snapshot, simulation.snapshot())) {
+		std::fprintf(stderr, "can't write to %s\n", settings.snapshot.c_str());
+		return 1;
+	}
+
+	Sprites &sprites = simulation.sprites();
+	SpriteStore::Range yonkers = sprites.range(SpriteStore::YONKER);
+
+	if (simulation.playback() != nullptr) {
+		std::printf("%s played back, %zu sprites (%zu Yonkers), %d frames of %zu recorded, %ldx%ld\n",
+			settings.replay.c_str(), sprites.size(), yonkers.last - yonkers.first,
+			settings.frames, simulation.playback()->frame_count(), settings.width, settings.height);
+	} else {
+		std::printf("%s, %zu sprites (%zu Yonkers), %d frames, %ldx%ld, %s noise, seed %llu, %d thread%s\n",
+			name_of(pattern_names, settings.pattern).c_str(), sprites.size(), yonkers.last - yonkers.first,
+			settings.frames, settings.width, settings.height, name_of(noise_names, settings.noise).c_str(),
+			(unsigned long long) settings.seed, settings.threads, settings.threads == 1 ? "" : "s");
+	}
+
+	if (settings.scenes > 1) {
+		std::printf("%d scenes side by side\n", settings.scenes);
+	}
+
+	if (settings.trail_length > 0) {
+		std::printf("trails: %d points, %d frames apart\n", SpriteStore::get_trail_length(), SpriteStore::get_trail_space());
+	}
+
+	auto report = [&](const char *name, double seconds) {
+		std::printf("  %-10s %10.3f ms  %10.3f us/frame  %5.1f%%\n",
+			name, seconds * 1e3, seconds * 1e6 / settings.frames, total > 0.0 ? seconds / total * 100.0 : 0.0);
+	};
+
+	double staged = 0.0;
+	for (size_t s = 0; s < (size_t) Stage::_STAGE_COUNT; s++) {
+		double seconds = ctx.stages().seconds((Stage) s);
+		if (seconds > 0.0) {
+			report(StageClock::name((Stage) s), seconds);
+			staged += seconds;
+		}
+	}
+	report("other", (std::max)(total - staged, 0.0));
+	report("total", total);
+
+	std::printf("%.1f frames/sec\n", settings.frames / total);
+	uint64_t sum = checksum(sprites);
+	std::printf("checksum %016llx\n", (unsigned long long) sum);
+
+	int strays = 0;
+	for (size_t i = 1; i < instances.size(); i++) {
+		uint64_t other = checksum(instances[i].simulation->sprites());
+		if (other != sum) {
+			std::printf("scene %zu went its own way: checksum %016llx\n", i, (unsigned long long) other);
+			strays++;
+		}
+	}
+
+	return strays == 0 ? 0 : 1;
+}
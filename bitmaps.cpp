@@ -1,12 +1,13 @@
 #include <map>
+#include <mutex>
 #include <algorithm>
 
-#include <Windows.h>
-#include <gl/GL.h>
+#include "platform.h"
 
 #include "bitmaps.h"
 #include <iterator>
 
+#ifndef YOK_HEADLESS
 HANDLE Bitmaps::load_raw_resource(int resource_id) {
 	HANDLE bitmap_resource = LoadImage(
 		GetModuleHandle(NULL), 
@@ -22,7 +23,9 @@ HANDLE Bitmaps::load_raw_resource(int resource_id) {
 
 BitmapData *Bitmaps::load(int resource_id) {
 	static std::map<int, BitmapData *> bitmap_cache;
+	static std::mutex bitmap_cache_mutex;
 
+	std::lock_guard<std::mutex> lock(bitmap_cache_mutex);
 	if (bitmap_cache.find(resource_id) != bitmap_cache.end()) {
 		return bitmap_cache.at(resource_id);
 	}
@@ -39,6 +42,26 @@ BitmapData *Bitmaps::load(int resource_id) {
 
 	return new_bitmap;
 }
+#else
+// There are no resources to load from without the .scr around them, and no one
+// to look at them anyway; every bitmap is a blank, but still a bitmap of its own.
+BitmapData *Bitmaps::load(int resource_id) {
+	static std::map<int, BitmapData *> bitmap_cache;
+	static std::mutex bitmap_cache_mutex;
+
+	std::lock_guard<std::mutex> lock(bitmap_cache_mutex);
+	if (bitmap_cache.find(resource_id) != bitmap_cache.end()) {
+		return bitmap_cache.at(resource_id);
+	}
+
+	static const std::array<GLubyte, BITMAP_WH * BITMAP_WH> blank = {};
+
+	BitmapData *new_bitmap = new BitmapData(blank.data());
+	bitmap_cache[resource_id] = new_bitmap;
+
+	return new_bitmap;
+}
+#endif
 
 std::vector<Bitmaps::Definition> Bitmaps::bitmaps_of_group(BitmapGroup group) {
 	std::vector<Bitmaps::Definition> bitmaps;
@@ -33,7 +33,9 @@ struct Bitmaps {
 		BitmapData *data;
 	};
 
+#ifndef YOK_HEADLESS
 	static HANDLE load_raw_resource(int resource_id);
+#endif
 	static BitmapData *load(int resource_id);
 
 	inline const static Definition Cvjoy = {
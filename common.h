@@ -1,9 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 
 using Id = unsigned int;
-static Id running_id = 0;
+// One count for the whole program, so no two things ever share an id, whichever file made them.
+inline std::atomic<Id> running_id = 0;
 
 class Empty { };
 template <typename Base> class Identifiable : public Base {
@@ -18,6 +20,15 @@ private:
 	Id m_id;
 };
 
+// What the simulation counts in. Floats are plenty at screen resolution, and twice
+// as many fit in a SIMD register; build with YOK_DOUBLE_PRECISION to get doubles
+// back, to compare against.
+#ifdef YOK_DOUBLE_PRECISION
+using Real = double;
+#else
+using Real = float;
+#endif
+
 using Color = std::tuple<unsigned char, unsigned char, unsigned char, unsigned char>;
 enum Channel {
 	RED = 0,
@@ -1,8 +1,5 @@
-#include <Windows.h>
-
 #include <vector>
 #include <utility>
-#include <format>
 #include <algorithm>
 
 #include "config.h"
@@ -24,6 +21,7 @@ double Config::operator[](const Cfg::Definition &opt) const {
 	return m_store[opt.index];
 }
 
+#ifndef YOK_HEADLESS
 Registry::Registry() 
 	: m_reg_key(NULL)
 {
@@ -47,6 +45,18 @@ Registry::Registry()
 Registry::~Registry() {
 	RegCloseKey(m_reg_key);
 }
+#else
+// Headless, the "registry" only lasts as long as the process does.
+static std::map<std::wstring, std::wstring> &headless_registry() {
+	static std::map<std::wstring, std::wstring> values;
+	return values;
+}
+
+Registry::Registry()
+	: m_reg_key(NULL) { }
+
+Registry::~Registry() { }
+#endif
 
 Config Registry::get_config() {
 	Registry registry;
@@ -78,6 +88,7 @@ double Registry::get(const std::wstring &opt, double default_) {
 	return std::stof(value);
 }
 
+#ifndef YOK_HEADLESS
 std::wstring Registry::get_string(const std::wstring &opt, const std::wstring &default_) {
 	wchar_t result[1 << 12] {};
 	DWORD result_type;
@@ -99,11 +110,18 @@ std::wstring Registry::get_string(const std::wstring &opt, const std::wstring &d
 
 	return result;
 }
+#else
+std::wstring Registry::get_string(const std::wstring &opt, const std::wstring &default_) {
+	auto value = headless_registry().find(opt);
+	return value != headless_registry().end() ? value->second : default_;
+}
+#endif
 
 void Registry::write(const std::wstring &opt, double value) {
 	write_string(opt, std::to_wstring(value));
 }
 
+#ifndef YOK_HEADLESS
 void Registry::write_string(const std::wstring &opt, const std::wstring &value) {
 	auto data_size = cast<DWORD>((value.size() + 1) * 2);
 
@@ -123,9 +141,18 @@ void Registry::remove(const std::wstring &opt) {
 		opt.c_str()
 	);
 }
+#else
+void Registry::write_string(const std::wstring &opt, const std::wstring &value) {
+	headless_registry()[opt] = value;
+}
+
+void Registry::remove(const std::wstring &opt) {
+	headless_registry().erase(opt);
+}
+#endif
 
 RegistryBackedMap::RegistryBackedMap(const std::wstring &prefix)
-	: m_prefix(prefix), m_index_key(std::format(L"_{}_index", prefix)) { }
+	: m_prefix(prefix), m_index_key(L"_" + prefix + L"_index") { }
 
 std::wstring RegistryBackedMap::get(const std::wstring &key, const std::wstring &default_) {
 	Registry registry;
@@ -163,7 +190,7 @@ std::vector<std::pair<std::wstring, std::wstring>> RegistryBackedMap::items() {
 }
 
 std::wstring RegistryBackedMap::prefix_key(const std::wstring &key) {
-	auto prefixed_key = std::format(L"_{}:{}", m_prefix, key);
+	auto prefixed_key = L"_" + m_prefix + L":" + key;
 	return prefixed_key;
 }
 
@@ -1,13 +1,13 @@
 #pragma once
 
-#include <Windows.h>
-
+#include <cmath>
 #include <map>
 #include <string>
 #include <optional>
 #include <vector>
 #include <set>
 
+#include "platform.h"
 #include "resourcew.h"
 
 struct Cfg {
@@ -169,7 +169,7 @@ struct Cfg {
 	inline const static Definition MaxTrailCount = {
 		.index = __COUNTER__,
 		.name = L"MaxTrailCount",
-		.default_ = 3000.0,
+		.default_ = 5000.0,
 	};
 
 	inline const static Definition TrailsEnabled = {
@@ -179,6 +179,74 @@ struct Cfg {
 		.dialog_control_id = IDC_TRAILS_ENABLED,
 	};
 
+	// Which noise the Yonkers feel their feelings with; see NoiseEngine.
+	inline const static Definition EmotionNoise = {
+		.index = __COUNTER__,
+		.name = L"EmotionNoise",
+		.default_ = 0.0,
+		.range = { 0.0, 2.0 },
+	};
+
+	inline const static Definition NoiseVolumeSize = {
+		.index = __COUNTER__,
+		.name = L"NoiseVolumeSize",
+		.default_ = 64.0,
+		.range = { 16.0, 128.0 },
+	};
+
+	// Only refresh one in every this many Yonkers' emotions per frame;
+	// the rest carry on with what they were last feeling.
+	inline const static Definition EmotionRefreshInterval = {
+		.index = __COUNTER__,
+		.name = L"EmotionRefreshInterval",
+		.default_ = 1.0,
+		.range = { 1.0, 16.0 },
+	};
+
+	// The whole session can be replayed from this; 0 picks a new one every time.
+	// It goes through the registry as a float, so keep it below 2^24.
+	inline const static Definition Seed = {
+		.index = __COUNTER__,
+		.name = L"Seed",
+		.default_ = 0.0,
+		.range = { 0.0, 16777215.0 },
+	};
+
+	// How many threads move the sprites along each frame; 0 means one per core.
+	// Any count gives the same picture for the same seed.
+	inline const static Definition UpdateThreads = {
+		.index = __COUNTER__,
+		.name = L"UpdateThreads",
+		.default_ = 1.0,
+		.range = { 0.0, 64.0 },
+	};
+
+	// Simulation steps per second, however often the screen gets drawn.
+	inline const static Definition StepRate = {
+		.index = __COUNTER__,
+		.name = L"StepRate",
+		.default_ = 60.0,
+		.range = { 10.0, 240.0 },
+	};
+
+	// How far a Flock sprite can see the rest of its flock, counted in how far apart
+	// everyone started out; the more sprites, the less far that is.
+	inline const static Definition FlockRadius = {
+		.index = __COUNTER__,
+		.name = L"FlockRadius",
+		.default_ = 3.0,
+		.range = { 1.0, 10.0 },
+	};
+
+	// How close Orbit lets a far-off crowd get before it stops treating it as one heavy
+	// point; smaller is more exact and slower, and 0 adds up every pair.
+	inline const static Definition OrbitOpeningAngle = {
+		.index = __COUNTER__,
+		.name = L"OrbitOpeningAngle",
+		.default_ = 0.5,
+		.range = { 0.0, 1.5 },
+	};
+
 	inline const static std::set<Definition> All = {
 		StepSize,
 		HomeDrift,
@@ -199,6 +267,14 @@ struct Cfg {
 		TrailSpace,
 		MaxTrailCount,
 		TrailsEnabled,
+		EmotionNoise,
+		NoiseVolumeSize,
+		EmotionRefreshInterval,
+		Seed,
+		UpdateThreads,
+		StepRate,
+		FlockRadius,
+		OrbitOpeningAngle,
 	};
 };
 
@@ -258,4 +334,10 @@ private:
 	void remove_from_index(Registry &registry, const std::wstring &key);
 };
 
+#ifndef YOK_HEADLESS
 const static Config cfg = Registry::get_config();
+#else
+// There's no registry to read from, so everything starts out at its default,
+// and whoever's driving changes what it likes before making anything.
+inline Config cfg;
+#endif
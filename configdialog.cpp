@@ -615,7 +615,9 @@ void PaletteCustomizeDialog::delete_current_palette() {
 }
 
 std::wstring PaletteCustomizeDialog::get_png_export_path(const std::wstring &base_path, const std::wstring &palette_name) {
-	return std::format(L"{}\\yokins-{}-{}", base_path, palette_name, cast<int>(Noise::random() * 10000.0));
+	// There's no session out here to borrow luck from, so the clock will have to do.
+	Random rng(cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+	return std::format(L"{}\\yokins-{}-{}", base_path, palette_name, cast<int>(Noise::random(rng) * 10000.0));
 }
 
 void PaletteCustomizeDialog::do_png_export(const std::wstring &path, const CurrentPalette &palette) {
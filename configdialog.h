@@ -139,6 +139,10 @@ const static std::map<PatternName, std::wstring> pattern_strings = {
 	{ Rose, L"Rose" },
 	{ Lattice, L"Lattice" },
 	{ Bubbles, L"Bubbles" },
+	{ Eddies, L"Eddies" },
+	{ Flock, L"Flock" },
+	{ Orbit, L"Orbit" },
+	{ Currents, L"Currents" },
 };
 
 const static std::map<PaletteGroup, std::wstring> palette_strings = {
@@ -1,7 +1,8 @@
 #include "context.h"
 #include "config.h"
 
-Context::Context(HWND window) : m_window(window), m_frame_count(0) {
+#ifndef YOK_HEADLESS
+Context::Context(HWND window) : m_window(window), m_vsync(false), m_frame_count(0) {
 	PIXELFORMATDESCRIPTOR pfd{};
 	pfd.nSize = sizeof pfd;
 	pfd.nVersion = 1;
@@ -25,9 +26,18 @@ Context::Context(HWND window) : m_window(window), m_frame_count(0) {
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+	// Wait for the display before swapping, if the driver lets us.
+	using SwapIntervalFunction = BOOL (WINAPI *)(int interval);
+	auto swap_interval = (SwapIntervalFunction) wglGetProcAddress("wglSwapIntervalEXT");
+	if (swap_interval != NULL) {
+		m_vsync = swap_interval(1) != FALSE;
+	}
+
 	GetClientRect(window, &m_rect);
 
-	SetTimer(window, ANIM_TIMER_ID, SIXTY_FPS, NULL);
+	if (!m_vsync) {
+		SetTimer(window, ANIM_TIMER_ID, RENDER_TICK, NULL);
+	}
 }
 
 Context::~Context() {
@@ -38,6 +48,14 @@ Context::~Context() {
 	KillTimer(m_window, ANIM_TIMER_ID);
 }
 
+void Context::make_current() {
+	wglMakeCurrent(m_device, m_gl);
+}
+#else
+Context::Context(LONG width, LONG height)
+	: m_window(NULL), m_device(NULL), m_gl(NULL), m_rect({ 0, 0, width, height }), m_vsync(false), m_frame_count(0) { }
+#endif
+
 HDC Context::device() {
 	return m_device;
 }
@@ -46,6 +64,10 @@ HGLRC Context::gl() {
 	return m_gl;
 }
 
+bool Context::vsync() {
+	return m_vsync;
+}
+
 RECT Context::rect() {
 	return m_rect;
 }
@@ -54,6 +76,56 @@ unsigned int &Context::frame_count() {
 	return m_frame_count;
 }
 
+StageClock &Context::stages() {
+	return m_stages;
+}
+
+RandomStreams &Context::streams() {
+	return m_streams;
+}
+
+Random &Context::rng(RandomStream stream) {
+	return m_streams.get(stream);
+}
+
+GLuint &Context::texture_id(const Texture *texture) {
+	return m_texture_ids[texture];
+}
+
 double Context::t() {
 	return m_frame_count / cfg[Cfg::TimeDivisor];
-}
\ No newline at end of file
+}
+
+StageClock::Scope::Scope(StageClock &clock, Stage stage)
+	: m_clock(clock), m_stage(stage), m_start(std::chrono::steady_clock::now()) { }
+
+StageClock::Scope::~Scope() {
+	m_clock.m_seconds[(size_t) m_stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+double StageClock::seconds(Stage stage) const {
+	return m_seconds[(size_t) stage];
+}
+
+void StageClock::reset() {
+	m_seconds = {};
+}
+
+const char *StageClock::name(Stage stage) {
+	switch (stage) {
+		case Stage::Patterns:
+			return "patterns";
+		case Stage::Emotions:
+			return "emotions";
+		case Stage::Drift:
+			return "drift";
+		case Stage::Sprites:
+			return "sprites";
+		case Stage::Recording:
+			return "recording";
+		case Stage::Playback:
+			return "playback";
+		default:
+			return "?";
+	}
+}
@@ -1,23 +1,86 @@
 #pragma once
 
-#include <windows.h>
-#include <gl/GL.h>
-#include <gl/GLU.h>
+#include <array>
+#include <chrono>
+#include <map>
+
+#include "platform.h"
+#include "noise.h"
+
+class Texture;
 
 constexpr static int ANIM_TIMER_ID = 1;
 
-// 17 is close enough to 16.66666...
-constexpr static int SIXTY_FPS = 17;
+#ifndef YOK_HEADLESS
+// Only for when the driver won't wait for the display: then a timer paces drawing
+// instead, which Windows only ticks every 15.6 ms or so. How fast things move is up
+// to the simulation's own clock (see Scene::advance), not this.
+constexpr static int RENDER_TICK = USER_TIMER_MINIMUM;
+#endif
+
+// The parts of a simulation step, for telling where the time goes.
+enum class Stage {
+	Patterns,
+	Emotions,
+	Drift,
+	Sprites,
+	Recording,
+	Playback,
+	_STAGE_COUNT
+};
+
+// Adds up how long each stage has taken, across however many steps.
+class StageClock {
+public:
+	// Times from its making to its end, and books it under the stage.
+	class Scope {
+	public:
+		Scope(StageClock &clock, Stage stage);
+		~Scope();
+
+	private:
+		StageClock &m_clock;
+		Stage m_stage;
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	double seconds(Stage stage) const;
+	void reset();
+
+	static const char *name(Stage stage);
+
+private:
+	std::array<double, (size_t) Stage::_STAGE_COUNT> m_seconds = {};
+};
 
 class Context {
 public:
+#ifndef YOK_HEADLESS
 	Context(HWND window);
 	~Context();
 
+	// Points GL at this context's window. Every scene has its own context, and GL only
+	// knows about whichever one was made current last, so draw with this first.
+	void make_current();
+#else
+	// Nothing to draw on; just how big the screen would be.
+	Context(LONG width, LONG height);
+#endif
+
 	HDC device();
 	HGLRC gl();
 	RECT rect();
+	// Whether SwapBuffers waits for the display. If it does, drawing again as soon as
+	// each frame's done keeps up with the refresh rate, whatever it is.
+	bool vsync();
+	// How many simulation steps have been run; nothing to do with how many frames were drawn.
 	unsigned int &frame_count();
+	StageClock &stages();
+	// This session's luck. Nothing outside the session draws from it.
+	RandomStreams &streams();
+	Random &rng(RandomStream stream = RandomStream::General);
+	// Where texture lives in this context's GL; 0 until it's been uploaded here.
+	GLuint &texture_id(const Texture *texture);
 
 	double t();
 
@@ -26,5 +89,9 @@ private:
 	HDC m_device;
 	HGLRC m_gl;
 	RECT m_rect;
+	bool m_vsync;
 	unsigned int m_frame_count;
-};
\ No newline at end of file
+	StageClock m_stages;
+	RandomStreams m_streams;
+	std::map<const Texture *, GLuint> m_texture_ids;
+};
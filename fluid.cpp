@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "fluid.h"
+#include "simd.h"
+#include "snapshot.h"
+
+// The SIMD kernels below have to land on the same bits as these, so every sum here is
+// written in the order the kernels do it, and nothing gets rearranged for neatness.
+
+static inline float lerp(float a, float b, float t) {
+	return a + (b - a) * t;
+}
+
+// Same as _mm256_min_ps and _mm256_max_ps, NaN and all: unless a wins outright, it's b.
+static inline float min_ps(float a, float b) {
+	return a < b ? a : b;
+}
+
+static inline float max_ps(float a, float b) {
+	return a > b ? a : b;
+}
+
+static inline int wrap_down(int i, int size) {
+	i += i < 0 ? size : 0;
+	return i - (i > size - 1 ? size : 0);
+}
+
+static inline int wrap_up(int i, int size) {
+	return i - (i > size - 1 ? size : 0);
+}
+
+static void advect_range(const float *u, const float *v, int width, int height, int y,
+                         float dt, float trace, float keep, float *u_out, float *v_out, int first, int last) {
+	const float *u_row = u + cast<size_t>(y) * width;
+	const float *v_row = v + cast<size_t>(y) * width;
+
+	for (int i = first; i < last; i++) {
+		// Where the water that ends up here was a step ago.
+		float dx = max_ps(min_ps(dt * u_row[i], trace), -trace);
+		float dy = max_ps(min_ps(dt * v_row[i], trace), -trace);
+		float x = cast<float>(i) - dx;
+		float from_y = cast<float>(y) - dy;
+
+		float x0 = std::floor(x);
+		float y0 = std::floor(from_y);
+		float tx = x - x0;
+		float ty = from_y - y0;
+
+		int ix = wrap_down(cast<int>(x0), width);
+		int iy = wrap_down(cast<int>(y0), height);
+		int ix1 = wrap_up(ix + 1, width);
+		int iy1 = wrap_up(iy + 1, height);
+
+		size_t r0 = cast<size_t>(iy) * width;
+		size_t r1 = cast<size_t>(iy1) * width;
+
+		u_out[i] = lerp(lerp(u[r0 + ix], u[r0 + ix1], tx), lerp(u[r1 + ix], u[r1 + ix1], tx), ty) * keep;
+		v_out[i] = lerp(lerp(v[r0 + ix], v[r0 + ix1], tx), lerp(v[r1 + ix], v[r1 + ix1], tx), ty) * keep;
+	}
+}
+
+static void divergence_range(const float *u, const float *v_prev, const float *v_next, int width, float *out, int first, int last) {
+	for (int i = first; i < last; i++) {
+		int left = i == 0 ? width - 1 : i - 1;
+		int right = i == width - 1 ? 0 : i + 1;
+		out[i] = 0.5f * ((u[right] - u[left]) + (v_next[i] - v_prev[i]));
+	}
+}
+
+static void jacobi_range(const float *p, const float *p_prev, const float *p_next, const float *divergence, int width, float *out, int first, int last) {
+	for (int i = first; i < last; i++) {
+		int left = i == 0 ? width - 1 : i - 1;
+		int right = i == width - 1 ? 0 : i + 1;
+		out[i] = ((p[left] + p[right]) + (p_prev[i] + p_next[i]) - divergence[i]) * 0.25f;
+	}
+}
+
+static void project_range(const float *p, const float *p_prev, const float *p_next, int width, float *u, float *v, int first, int last) {
+	for (int i = first; i < last; i++) {
+		int left = i == 0 ? width - 1 : i - 1;
+		int right = i == width - 1 ? 0 : i + 1;
+		u[i] -= 0.5f * (p[right] - p[left]);
+		v[i] -= 0.5f * (p_next[i] - p_prev[i]);
+	}
+}
+
+static void advect_scalar(const float *u, const float *v, int width, int height, int y,
+                          float dt, float trace, float keep, float *u_out, float *v_out) {
+	advect_range(u, v, width, height, y, dt, trace, keep, u_out, v_out, 0, width);
+}
+
+static void divergence_scalar(const float *u, const float *v_prev, const float *v_next, int width, float *out) {
+	divergence_range(u, v_prev, v_next, width, out, 0, width);
+}
+
+static void jacobi_scalar(const float *p, const float *p_prev, const float *p_next, const float *divergence, int width, float *out) {
+	jacobi_range(p, p_prev, p_next, divergence, width, out, 0, width);
+}
+
+static void project_scalar(const float *p, const float *p_prev, const float *p_next, int width, float *u, float *v) {
+	project_range(p, p_prev, p_next, width, u, v, 0, width);
+}
+
+#ifdef YOK_X86
+YOK_TARGET("avx2") static inline __m256 lerp(__m256 a, __m256 b, __m256 t) {
+	return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+}
+
+YOK_TARGET("avx2") static inline __m256i wrap_down(__m256i i, __m256i size, __m256i last) {
+	i = _mm256_add_epi32(i, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), i), size));
+	return _mm256_sub_epi32(i, _mm256_and_si256(_mm256_cmpgt_epi32(i, last), size));
+}
+
+YOK_TARGET("avx2") static inline __m256i wrap_up(__m256i i, __m256i size, __m256i last) {
+	return _mm256_sub_epi32(i, _mm256_and_si256(_mm256_cmpgt_epi32(i, last), size));
+}
+
+// Bilinear between four gathered corners, the same way advect_range does it.
+YOK_TARGET("avx2") static inline __m256 gather_lerp(const float *values, __m256i r0, __m256i r1, __m256i ix, __m256i ix1, __m256 tx, __m256 ty) {
+	__m256 s00 = _mm256_i32gather_ps(values, _mm256_add_epi32(r0, ix), 4);
+	__m256 s10 = _mm256_i32gather_ps(values, _mm256_add_epi32(r0, ix1), 4);
+	__m256 s01 = _mm256_i32gather_ps(values, _mm256_add_epi32(r1, ix), 4);
+	__m256 s11 = _mm256_i32gather_ps(values, _mm256_add_epi32(r1, ix1), 4);
+
+	return lerp(lerp(s00, s10, tx), lerp(s01, s11, tx), ty);
+}
+
+YOK_TARGET("avx2") static void advect_avx2(const float *u, const float *v, int width, int height, int y,
+                                           float dt, float trace, float keep, float *u_out, float *v_out) {
+	const float *u_row = u + cast<size_t>(y) * width;
+	const float *v_row = v + cast<size_t>(y) * width;
+
+	const __m256 dt_v = _mm256_set1_ps(dt);
+	const __m256 high = _mm256_set1_ps(trace);
+	const __m256 low = _mm256_set1_ps(-trace);
+	const __m256 keep_v = _mm256_set1_ps(keep);
+	const __m256 row_y = _mm256_set1_ps(cast<float>(y));
+
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i w = _mm256_set1_epi32(width);
+	const __m256i w_last = _mm256_set1_epi32(width - 1);
+	const __m256i h = _mm256_set1_epi32(height);
+	const __m256i h_last = _mm256_set1_epi32(height - 1);
+
+	int i = 0;
+	for (; i + 8 <= width; i += 8) {
+		__m256 dx = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(dt_v, _mm256_loadu_ps(u_row + i)), high), low);
+		__m256 dy = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(dt_v, _mm256_loadu_ps(v_row + i)), high), low);
+		__m256 x = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), lanes)), dx);
+		__m256 from_y = _mm256_sub_ps(row_y, dy);
+
+		__m256 x0 = _mm256_floor_ps(x);
+		__m256 y0 = _mm256_floor_ps(from_y);
+		__m256 tx = _mm256_sub_ps(x, x0);
+		__m256 ty = _mm256_sub_ps(from_y, y0);
+
+		__m256i ix = wrap_down(_mm256_cvttps_epi32(x0), w, w_last);
+		__m256i iy = wrap_down(_mm256_cvttps_epi32(y0), h, h_last);
+		__m256i ix1 = wrap_up(_mm256_add_epi32(ix, one), w, w_last);
+		__m256i iy1 = wrap_up(_mm256_add_epi32(iy, one), h, h_last);
+
+		__m256i r0 = _mm256_mullo_epi32(iy, w);
+		__m256i r1 = _mm256_mullo_epi32(iy1, w);
+
+		_mm256_storeu_ps(u_out + i, _mm256_mul_ps(gather_lerp(u, r0, r1, ix, ix1, tx, ty), keep_v));
+		_mm256_storeu_ps(v_out + i, _mm256_mul_ps(gather_lerp(v, r0, r1, ix, ix1, tx, ty), keep_v));
+	}
+
+	_mm256_zeroupper();
+	advect_range(u, v, width, height, y, dt, trace, keep, u_out, v_out, i, width);
+}
+
+// The stencils below reach one cell left and right, so the ends of each row, where
+// that wraps around, are left to the plain versions. Every row hands off to them, so
+// the upper halves get cleared first; the compiler doesn't always, and running plain
+// SSE with them dirty made the whole solve several times slower.
+
+YOK_TARGET("avx2") static void divergence_avx2(const float *u, const float *v_prev, const float *v_next, int width, float *out) {
+	const __m256 half = _mm256_set1_ps(0.5f);
+
+	int i = 1;
+	for (; i + 8 <= width - 1; i += 8) {
+		__m256 du = _mm256_sub_ps(_mm256_loadu_ps(u + i + 1), _mm256_loadu_ps(u + i - 1));
+		__m256 dv = _mm256_sub_ps(_mm256_loadu_ps(v_next + i), _mm256_loadu_ps(v_prev + i));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(half, _mm256_add_ps(du, dv)));
+	}
+
+	_mm256_zeroupper();
+	divergence_range(u, v_prev, v_next, width, out, 0, (std::min)(1, width));
+	divergence_range(u, v_prev, v_next, width, out, i, width);
+}
+
+YOK_TARGET("avx2") static void jacobi_avx2(const float *p, const float *p_prev, const float *p_next, const float *divergence, int width, float *out) {
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+
+	int i = 1;
+	for (; i + 8 <= width - 1; i += 8) {
+		__m256 across = _mm256_add_ps(_mm256_loadu_ps(p + i - 1), _mm256_loadu_ps(p + i + 1));
+		__m256 along = _mm256_add_ps(_mm256_loadu_ps(p_prev + i), _mm256_loadu_ps(p_next + i));
+		__m256 sum = _mm256_sub_ps(_mm256_add_ps(across, along), _mm256_loadu_ps(divergence + i));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(sum, quarter));
+	}
+
+	_mm256_zeroupper();
+	jacobi_range(p, p_prev, p_next, divergence, width, out, 0, (std::min)(1, width));
+	jacobi_range(p, p_prev, p_next, divergence, width, out, i, width);
+}
+
+YOK_TARGET("avx2") static void project_avx2(const float *p, const float *p_prev, const float *p_next, int width, float *u, float *v) {
+	const __m256 half = _mm256_set1_ps(0.5f);
+
+	int i = 1;
+	for (; i + 8 <= width - 1; i += 8) {
+		__m256 dx = _mm256_mul_ps(half, _mm256_sub_ps(_mm256_loadu_ps(p + i + 1), _mm256_loadu_ps(p + i - 1)));
+		__m256 dy = _mm256_mul_ps(half, _mm256_sub_ps(_mm256_loadu_ps(p_next + i), _mm256_loadu_ps(p_prev + i)));
+		_mm256_storeu_ps(u + i, _mm256_sub_ps(_mm256_loadu_ps(u + i), dx));
+		_mm256_storeu_ps(v + i, _mm256_sub_ps(_mm256_loadu_ps(v + i), dy));
+	}
+
+	_mm256_zeroupper();
+	project_range(p, p_prev, p_next, width, u, v, 0, (std::min)(1, width));
+	project_range(p, p_prev, p_next, width, u, v, i, width);
+}
+#endif
+
+FlowField::AdvectKernel FlowField::select_advect_kernel() {
+#ifdef YOK_X86
+	if (simd_level() == SimdLevel::AVX2) {
+		return advect_avx2;
+	}
+#endif
+
+	return advect_scalar;
+}
+
+FlowField::DivergenceKernel FlowField::select_divergence_kernel() {
+#ifdef YOK_X86
+	if (simd_level() == SimdLevel::AVX2) {
+		return divergence_avx2;
+	}
+#endif
+
+	return divergence_scalar;
+}
+
+FlowField::JacobiKernel FlowField::select_jacobi_kernel() {
+#ifdef YOK_X86
+	if (simd_level() == SimdLevel::AVX2) {
+		return jacobi_avx2;
+	}
+#endif
+
+	return jacobi_scalar;
+}
+
+FlowField::ProjectKernel FlowField::select_project_kernel() {
+#ifdef YOK_X86
+	if (simd_level() == SimdLevel::AVX2) {
+		return project_avx2;
+	}
+#endif
+
+	return project_scalar;
+}
+
+const FlowField::AdvectKernel FlowField::advect_kernel = FlowField::select_advect_kernel();
+const FlowField::DivergenceKernel FlowField::divergence_kernel = FlowField::select_divergence_kernel();
+const FlowField::JacobiKernel FlowField::jacobi_kernel = FlowField::select_jacobi_kernel();
+const FlowField::ProjectKernel FlowField::project_kernel = FlowField::select_project_kernel();
+
+void FlowField::resize(int width, int height) {
+	m_width = (std::max)(width, 0);
+	m_height = (std::max)(height, 0);
+
+	size_t cells = cast<size_t>(m_width) * m_height;
+	for (std::vector<float> *values : { &m_u, &m_v, &m_pressure, &m_u_next, &m_v_next, &m_pressure_next, &m_divergence }) {
+		values->assign(cells, 0.0f);
+	}
+}
+
+int FlowField::width() const {
+	return m_width;
+}
+
+int FlowField::height() const {
+	return m_height;
+}
+
+const float *FlowField::row(const std::vector<float> &values, int y) const {
+	y = ((y % m_height) + m_height) % m_height;
+	return values.data() + cast<size_t>(y) * m_width;
+}
+
+void FlowField::stir(float x, float y, float radius, float spin, float dt) {
+	if (m_width == 0 || m_height == 0 || !(radius > 0)) {
+		return;
+	}
+
+	const float radius_sq = radius * radius;
+
+	for (int cy = cast<int>(std::floor(y - radius)); cy <= cast<int>(std::ceil(y + radius)); cy++) {
+		for (int cx = cast<int>(std::floor(x - radius)); cx <= cast<int>(std::ceil(x + radius)); cx++) {
+			float dx = cast<float>(cx) - x;
+			float dy = cast<float>(cy) - y;
+			float dist_sq = dx * dx + dy * dy;
+			if (!(dist_sq < radius_sq)) {
+				continue;
+			}
+
+			// Round and round, fastest halfway out, and still at the middle and the edge.
+			float push = spin * (1.0f - dist_sq / radius_sq) * dt / radius;
+			size_t c = cast<size_t>(((cy % m_height) + m_height) % m_height) * m_width + ((cx % m_width) + m_width) % m_width;
+			m_u[c] -= dy * push;
+			m_v[c] += dx * push;
+		}
+	}
+}
+
+void FlowField::step(float dt, float decay, WorkerPool &workers) {
+	if (m_width == 0 || m_height == 0) {
+		return;
+	}
+
+	const float keep = std::exp(-decay * dt);
+	const float trace = (std::min)(MAX_TRACE, cast<float>((std::min)(m_width, m_height) - 1));
+	const size_t stride = cast<size_t>(m_width);
+
+	// Every pass only writes its own rows, and only reads what the pass before it left,
+	// so the rows can be split up however.
+	auto rows = [&](const std::function<void(int y)> &pass) {
+		workers.run(cast<size_t>(m_height), ROWS, [&](size_t first, size_t last) {
+			for (size_t y = first; y < last; y++) {
+				pass(cast<int>(y));
+			}
+		});
+	};
+
+	rows([&](int y) {
+		advect_kernel(m_u.data(), m_v.data(), m_width, m_height, y, dt, trace, keep, m_u_next.data() + y * stride, m_v_next.data() + y * stride);
+	});
+	m_u.swap(m_u_next);
+	m_v.swap(m_v_next);
+
+	// How much more is flowing out of each cell than in...
+	rows([&](int y) {
+		divergence_kernel(row(m_u, y), row(m_v, y - 1), row(m_v, y + 1), m_width, m_divergence.data() + y * stride);
+	});
+
+	// ...what pressure it'd take to even that out...
+	for (int k = 0; k < PRESSURE_ITERATIONS; k++) {
+		rows([&](int y) {
+			jacobi_kernel(row(m_pressure, y), row(m_pressure, y - 1), row(m_pressure, y + 1), row(m_divergence, y), m_width, m_pressure_next.data() + y * stride);
+		});
+		m_pressure.swap(m_pressure_next);
+	}
+
+	// ...and the water getting pushed down the slope of it.
+	rows([&](int y) {
+		project_kernel(row(m_pressure, y), row(m_pressure, y - 1), row(m_pressure, y + 1), m_width, m_u.data() + y * stride, m_v.data() + y * stride);
+	});
+}
+
+FlowField::Flow FlowField::sample(float x, float y) const {
+	if (m_width == 0 || m_height == 0 || !std::isfinite(x) || !std::isfinite(y)) {
+		return { 0.0f, 0.0f };
+	}
+
+	// Back onto the grid first, so however far out it was, it fits in an int.
+	x -= std::floor(x / m_width) * m_width;
+	y -= std::floor(y / m_height) * m_height;
+
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float tx = x - x0;
+	float ty = y - y0;
+
+	int ix = wrap_down(cast<int>(x0), m_width);
+	int iy = wrap_down(cast<int>(y0), m_height);
+	int ix1 = wrap_up(ix + 1, m_width);
+	int iy1 = wrap_up(iy + 1, m_height);
+
+	size_t r0 = cast<size_t>(iy) * m_width;
+	size_t r1 = cast<size_t>(iy1) * m_width;
+
+	return {
+		lerp(lerp(m_u[r0 + ix], m_u[r0 + ix1], tx), lerp(m_u[r1 + ix], m_u[r1 + ix1], tx), ty),
+		lerp(lerp(m_v[r0 + ix], m_v[r0 + ix1], tx), lerp(m_v[r1 + ix], m_v[r1 + ix1], tx), ty),
+	};
+}
+
+void FlowField::save(SnapshotWriter &snapshot) const {
+	snapshot.put<int32_t>(m_width);
+	snapshot.put<int32_t>(m_height);
+	snapshot.put(m_u);
+	snapshot.put(m_v);
+	snapshot.put(m_pressure);
+}
+
+bool FlowField::load(SnapshotReader &snapshot) {
+	int32_t width, height;
+	std::vector<float> u, v, pressure;
+	if (!snapshot.get(width) || !snapshot.get(height) || !snapshot.get(u) || !snapshot.get(v) || !snapshot.get(pressure)) {
+		return false;
+	}
+
+	size_t cells = width >= 0 && height >= 0 ? cast<size_t>(width) * cast<size_t>(height) : SIZE_MAX;
+	if (u.size() != cells || v.size() != cells || pressure.size() != cells) {
+		return false;
+	}
+
+	resize(width, height);
+	m_u = std::move(u);
+	m_v = std::move(v);
+	m_pressure = std::move(pressure);
+	return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common.h"
+#include "workers.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// A coarse grid of moving water, width by height cells, that wraps around at the
+// edges the same way the sprites do. Velocities are in cells per time unit.
+//
+// Each step carries the water along itself (semi-Lagrangian: every cell looks back
+// along its own flow for what ends up there), then squeezes out whatever's piling up
+// or thinning out, so it swirls instead of bunching. It costs the same however many
+// sprites are riding it.
+//
+// The passes are split up by rows, and each row is done by a SIMD kernel that does
+// exactly the same arithmetic, in the same order, as the plain one. So whichever
+// kernel and however many threads, the water lands on the same bits.
+class FlowField {
+public:
+	struct Flow {
+		float x;
+		float y;
+	};
+
+	// Still water; anything that was there is gone.
+	void resize(int width, int height);
+
+	int width() const;
+	int height() const;
+
+	// Spins the water around (x, y), within radius cells of it, spin cells per time unit
+	// per time unit at the middle and nothing at the edge; positive spin turns clockwise
+	// on screen. Counts as dt time units' worth.
+	void stir(float x, float y, float radius, float spin, float dt);
+
+	// Moves the water along by dt time units, and takes decay of its speed per time unit away.
+	void step(float dt, float decay, WorkerPool &workers);
+
+	// The flow at (x, y), in cells, between the four cells nearest it; anywhere at all
+	// is fine, it wraps around. Safe to call from any number of threads at once.
+	Flow sample(float x, float y) const;
+
+	void save(SnapshotWriter &snapshot) const;
+	bool load(SnapshotReader &snapshot);
+
+	// Each kernel does one row. Advection needs the whole grid to look back into; the rest
+	// only need the rows before and after theirs, which are handed in already wrapped around,
+	// so the kernels only have to wrap left and right themselves.
+	using AdvectKernel = void (*)(const float *u, const float *v, int width, int height, int y,
+	                              float dt, float trace, float keep, float *u_out, float *v_out);
+	using DivergenceKernel = void (*)(const float *u, const float *v_prev, const float *v_next, int width, float *out);
+	using JacobiKernel = void (*)(const float *p, const float *p_prev, const float *p_next, const float *divergence, int width, float *out);
+	using ProjectKernel = void (*)(const float *p, const float *p_prev, const float *p_next, int width, float *u, float *v);
+
+private:
+	// Nothing's meant to go anywhere near this many cells in one step; it's only there so
+	// a wild value can't look back further than one wrap around.
+	constexpr static float MAX_TRACE = 16.0f;
+	// Rows a worker takes at a time.
+	constexpr static size_t ROWS = 8;
+	// Each step's squeeze starts from the last one's pressure, so only a few rounds are needed.
+	constexpr static int PRESSURE_ITERATIONS = 24;
+
+	// Row y, with y wrapped around.
+	const float *row(const std::vector<float> &values, int y) const;
+
+	static AdvectKernel select_advect_kernel();
+	static DivergenceKernel select_divergence_kernel();
+	static JacobiKernel select_jacobi_kernel();
+	static ProjectKernel select_project_kernel();
+
+	static const AdvectKernel advect_kernel;
+	static const DivergenceKernel divergence_kernel;
+	static const JacobiKernel jacobi_kernel;
+	static const ProjectKernel project_kernel;
+
+	int m_width = 0;
+	int m_height = 0;
+
+	std::vector<float> m_u;
+	std::vector<float> m_v;
+	std::vector<float> m_pressure;
+
+	// Only kept so their memory can be reused.
+	std::vector<float> m_u_next;
+	std::vector<float> m_v_next;
+	std::vector<float> m_pressure_next;
+	std::vector<float> m_divergence;
+};
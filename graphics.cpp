@@ -6,13 +6,24 @@ BitmapData::BitmapData(const std::initializer_list<GLubyte> &i_list) {
 
 const Texture *Texture::get(const PaletteData &palette, const BitmapData &bitmap) {
 	auto ids = std::make_pair(palette.id(), bitmap.id());
-	auto result = texture_cache.find(ids);
 
+	// Nearly every lookup finds what it's after, so they can all look at once;
+	// only making a new one needs everyone else to wait.
+	{
+		std::shared_lock<std::shared_mutex> lock(texture_cache_mutex);
+		auto result = texture_cache.find(ids);
+		if (result != texture_cache.end()) {
+			return result->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(texture_cache_mutex);
+	auto result = texture_cache.find(ids);
 	if (result == texture_cache.end()) {
-		texture_cache[ids] = new Texture(palette, bitmap);
+		result = texture_cache.emplace(ids, new Texture(palette, bitmap)).first;
 	}
 
-	return texture_cache.at(ids);
+	return result->second;
 }
 
 const Texture *Texture::of(const Palettes::Definition &palette, const Bitmaps::Definition &bitmap) {
@@ -27,21 +38,35 @@ BitmapData::BitmapData(const GLubyte *data) {
 	std::copy(data, data + size(), begin());
 }
 
-void Texture::apply() const {
-	glBindTexture(GL_TEXTURE_2D, m_gl_tex_id);
+void Texture::apply(Context &ctx) const {
+	GLuint &gl_tex_id = ctx.texture_id(this);
+	if (gl_tex_id == 0) {
+		upload(gl_tex_id);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, gl_tex_id);
 }
 
 const PaletteData &Texture::palette() const {
 	return m_palette;
 }
 
+const BitmapData &Texture::bitmap() const {
+	return m_bitmap;
+}
+
 std::map<std::pair<Id, Id>, Texture *> Texture::texture_cache{};
+std::shared_mutex Texture::texture_cache_mutex{};
 
 Texture::Texture(const PaletteData &palette, const BitmapData &bitmap)
-	: m_palette(palette), m_bitmap(bitmap)
-{
-	glGenTextures(1, &m_gl_tex_id);
-	glBindTexture(GL_TEXTURE_2D, m_gl_tex_id);
+	: m_palette(palette), m_bitmap(bitmap) { }
+
+// Only the thread that owns the GL context can talk to it, and that's the one that draws;
+// so textures can be looked up from anywhere, but they wait to be used to reach the GPU.
+// Every scene has a GL context of its own, so each one uploads its own copy.
+void Texture::upload(GLuint &gl_tex_id) const {
+	glGenTextures(1, &gl_tex_id);
+	glBindTexture(GL_TEXTURE_2D, gl_tex_id);
 
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -7,6 +7,8 @@
 #include <utility>
 #include <map>
 #include <string>
+#include <mutex>
+#include <shared_mutex>
 
 #include "context.h"
 #include "palettes.h"
@@ -15,13 +17,16 @@
 
 class Texture {
 public:
+	// Safe to call from any thread.
 	static const Texture *get(const PaletteData &palette, const BitmapData &bitmap);
 	static const Texture *of(const Palettes::Definition &palette, const Bitmaps::Definition &bitmap);
 	static const Texture *of(const PaletteData *palette, const Bitmaps::Definition &bitmap);
 
 	const PaletteData &palette() const;
+	const BitmapData &bitmap() const;
 
-	void apply() const;
+	// Binds it in ctx's GL, uploading it there first if it's new to it.
+	void apply(Context &ctx) const;
 
 	GLubyte *data() const;
 
@@ -30,15 +35,17 @@ private:
 	Texture(const Texture &texture) = delete;
 	Texture &operator=(const Texture &texture) = delete;
 
+	void upload(GLuint &gl_tex_id) const;
 
 	static std::map<std::pair<Id, Id>, Texture *> texture_cache;
+	static std::shared_mutex texture_cache_mutex;
 
-	unsigned int m_gl_tex_id;
 	const PaletteData &m_palette;
 	const BitmapData &m_bitmap;
 };
 
-using Point = std::pair<GLdouble, GLdouble>;
+template <typename T> using BasicPoint = std::pair<T, T>;
+using Point = BasicPoint<Real>;
 enum Coord {
 	X = 0,
 	Y = 1
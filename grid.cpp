@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cmath>
+
+#include "grid.h"
+
+void UniformGrid::sort(Real cell_width, Real cell_height) {
+	size_t n = m_xs.size();
+
+	Real left = 0, right = 0, top = 0, bottom = 0;
+	if (n > 0) {
+		auto [min_x, max_x] = std::minmax_element(m_xs.begin(), m_xs.end());
+		auto [min_y, max_y] = std::minmax_element(m_ys.begin(), m_ys.end());
+		left = *min_x;
+		right = *max_x;
+		top = *min_y;
+		bottom = *max_y;
+	}
+
+	// Enough cells to cover everyone, but never so many that most of them are empty;
+	// cells only ever get bigger than asked for, so the nine around a point still cover it.
+	// Written so that anything that isn't a number ends up as one cell, rather than as no idea.
+	auto at_least_one = [](double cells) {
+		return cells >= 1.0 ? cells : 1.0;
+	};
+
+	double columns = at_least_one(std::ceil((right - left) / cell_width));
+	double rows = at_least_one(std::ceil((bottom - top) / cell_height));
+	double max_cells = cast<double>((std::max)(n, (size_t) 1) * MAX_CELLS_PER_POINT);
+	if (!(columns * rows <= max_cells)) {
+		double shrink = std::sqrt(columns * rows / max_cells);
+		rows = at_least_one(std::floor((std::min)(rows / shrink, max_cells)));
+		columns = at_least_one(std::floor((std::min)(columns / shrink, max_cells / rows)));
+	}
+
+	m_left = left;
+	m_top = top;
+	m_columns = cast<int>(columns);
+	m_rows = cast<int>(rows);
+	m_cell_width = (std::max)(cell_width, cast<Real>((right - left) / m_columns));
+	m_cell_height = (std::max)(cell_height, cast<Real>((bottom - top) / m_rows));
+
+	// A counting sort: how many in each cell, where each cell starts, then everyone in order.
+	size_t cell_count = cast<size_t>(m_columns) * m_rows;
+	m_cell_starts.assign(cell_count + 1, 0);
+	m_cells.resize(n);
+	m_members.resize(n);
+
+	for (size_t i = 0; i < n; i++) {
+		m_cells[i] = cast<uint32_t>(cast<size_t>(row_of(m_ys[i])) * m_columns + column_of(m_xs[i]));
+		m_cell_starts[m_cells[i] + 1]++;
+	}
+
+	for (size_t c = 0; c < cell_count; c++) {
+		m_cell_starts[c + 1] += m_cell_starts[c];
+	}
+
+	// Borrowing the starts as a cursor leaves each one pointing at the next cell's start...
+	for (size_t i = 0; i < n; i++) {
+		m_members[m_cell_starts[m_cells[i]]++] = cast<uint32_t>(i);
+	}
+
+	// ...so shifting them all down one puts them back.
+	for (size_t c = cell_count; c > 0; c--) {
+		m_cell_starts[c] = m_cell_starts[c - 1];
+	}
+	m_cell_starts[0] = 0;
+
+	m_member_xs.resize(n);
+	m_member_ys.resize(n);
+	for (size_t m = 0; m < n; m++) {
+		m_member_xs[m] = m_xs[m_members[m]];
+		m_member_ys[m] = m_ys[m_members[m]];
+	}
+}
+
+// Anything off the edge, or not a number at all, goes in the nearest cell.
+int UniformGrid::column_of(Real x) const {
+	Real column = (x - m_left) / m_cell_width;
+	return column > 0 ? (std::min)(cast<int>((std::min)(column, cast<Real>(m_columns))), m_columns - 1) : 0;
+}
+
+int UniformGrid::row_of(Real y) const {
+	Real row = (y - m_top) / m_cell_height;
+	return row > 0 ? (std::min)(cast<int>((std::min)(row, cast<Real>(m_rows))), m_rows - 1) : 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+// Sorts points into cells at least as big as the distance anyone cares about, so
+// everyone that close to a point is somewhere in the nine cells around it, and
+// nobody has to look any further.
+//
+// Each cell lists its points in the order they were given, and cells are visited
+// in the same order every time, so what comes out depends only on what went in.
+class UniformGrid {
+public:
+	// Takes everyone's position from position(i), for i in [0, n), and sorts them into
+	// cells at least cell_width by cell_height. Memory is kept from one build to the next.
+	template <typename Position> void build(size_t n, Real cell_width, Real cell_height, Position &&position) {
+		m_xs.resize(n);
+		m_ys.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			auto [x, y] = position(i);
+			m_xs[i] = x;
+			m_ys[i] = y;
+		}
+
+		sort(cell_width, cell_height);
+	}
+
+	// Calls visit(j, x_j, y_j) for everyone in the nine cells around (x, y); that's everyone
+	// within a cell of it, and some who aren't, so the distance is still up to the caller.
+	// Positions come from a copy kept in cell order, so they're read straight through.
+	template <typename Visit> void visit_near(Real x, Real y, Visit &&visit) const {
+		int column = column_of(x);
+		int row = row_of(y);
+
+		for (int r = (std::max)(row - 1, 0); r <= (std::min)(row + 1, m_rows - 1); r++) {
+			size_t first = m_cell_starts[cast<size_t>(r) * m_columns + (std::max)(column - 1, 0)];
+			size_t last = m_cell_starts[cast<size_t>(r) * m_columns + (std::min)(column + 1, m_columns - 1) + 1];
+
+			// The three cells in a row sit next to each other, so they're one run.
+			for (size_t m = first; m < last; m++) {
+				visit(cast<size_t>(m_members[m]), m_member_xs[m], m_member_ys[m]);
+			}
+		}
+	}
+
+	// Where build() put point i.
+	Real x(size_t i) const {
+		return m_xs[i];
+	}
+
+	Real y(size_t i) const {
+		return m_ys[i];
+	}
+
+private:
+	// More cells than this many per point only costs memory, so past it they get bigger instead.
+	constexpr static size_t MAX_CELLS_PER_POINT = 2;
+
+	void sort(Real cell_width, Real cell_height);
+
+	int column_of(Real x) const;
+	int row_of(Real y) const;
+
+	std::vector<Real> m_xs;
+	std::vector<Real> m_ys;
+
+	Real m_left = 0;
+	Real m_top = 0;
+	Real m_cell_width = 1;
+	Real m_cell_height = 1;
+	int m_columns = 1;
+	int m_rows = 1;
+
+	// Cell c holds m_members[m_cell_starts[c]] up to m_members[m_cell_starts[c + 1]].
+	std::vector<uint32_t> m_cell_starts;
+	std::vector<uint32_t> m_members;
+	std::vector<Real> m_member_xs;
+	std::vector<Real> m_member_ys;
+	std::vector<uint32_t> m_cells;
+};
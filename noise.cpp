@@ -1,11 +1,106 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "noise.h"
 #include "common.h"
+#include "simd.h"
 
 double PerlinNoise::get(double x, double y, double z) {
 	Vector v = Vector(x, y, z);
 	return cell_interpolate(cell_dots(v), v);
 }
 
+template <typename T>
+PerlinNoise::BasicGradient<T> PerlinNoise::get_gradient(T x, T y, T z) {
+	T x0 = std::floor(x);
+	T y0 = std::floor(y);
+	T z0 = std::floor(z);
+
+	int ix = cast<int>(x0);
+	int iy = cast<int>(y0);
+	int iz = cast<int>(z0);
+
+	T fx = x - x0;
+	T fy = y - y0;
+	T fz = z - z0;
+
+	const Vector &g000 = grad_vector(ix, iy, iz);
+	const Vector &g100 = grad_vector(ix + 1, iy, iz);
+	const Vector &g010 = grad_vector(ix, iy + 1, iz);
+	const Vector &g110 = grad_vector(ix + 1, iy + 1, iz);
+	const Vector &g001 = grad_vector(ix, iy, iz + 1);
+	const Vector &g101 = grad_vector(ix + 1, iy, iz + 1);
+	const Vector &g011 = grad_vector(ix, iy + 1, iz + 1);
+	const Vector &g111 = grad_vector(ix + 1, iy + 1, iz + 1);
+
+	// The gradients are stored as doubles; bring them down to whatever we're working in.
+	auto dot = [](const Vector &g, T dx, T dy, T dz) {
+		return cast<T>(g.x()) * dx + cast<T>(g.y()) * dy + cast<T>(g.z()) * dz;
+	};
+
+	T d000 = dot(g000, fx, fy, fz);
+	T d100 = dot(g100, fx - 1, fy, fz);
+	T d010 = dot(g010, fx, fy - 1, fz);
+	T d110 = dot(g110, fx - 1, fy - 1, fz);
+	T d001 = dot(g001, fx, fy, fz - 1);
+	T d101 = dot(g101, fx - 1, fy, fz - 1);
+	T d011 = dot(g011, fx, fy - 1, fz - 1);
+	T d111 = dot(g111, fx - 1, fy - 1, fz - 1);
+
+	// The same smoothstep interpolate() uses, and how fast it's stepping.
+	auto fade = [](T w) { return (3 - w * 2) * w * w; };
+	auto fade_slope = [](T w) { return 6 * w * (1 - w); };
+
+	T u = fade(fx);
+	T v = fade(fy);
+	T w = fade(fz);
+
+	// Written out as a polynomial in u, v and w, the trilinear blend is easy to differentiate.
+	T k0 = d000;
+	T k1 = d100 - d000;
+	T k2 = d010 - d000;
+	T k3 = d001 - d000;
+	T k4 = d000 - d100 - d010 + d110;
+	T k5 = d000 - d010 - d001 + d011;
+	T k6 = d000 - d100 - d001 + d101;
+	T k7 = -d000 + d100 + d010 - d110 + d001 - d101 - d011 + d111;
+
+	// Each corner's gradient, weighted the same way as its dot product...
+	auto blend = [&](auto component) {
+		T a = cast<T>(component(g000));
+		T b = cast<T>(component(g100));
+		T c = cast<T>(component(g010));
+		T d = cast<T>(component(g110));
+		T e = cast<T>(component(g001));
+		T f = cast<T>(component(g101));
+		T g = cast<T>(component(g011));
+		T h = cast<T>(component(g111));
+
+		return a + u * (b - a) + v * (c - a) + w * (e - a)
+			+ u * v * (a - b - c + d) + v * w * (a - c - e + g) + w * u * (a - b - e + f)
+			+ u * v * w * (-a + b + c - d + e - f - g + h);
+	};
+
+	return {
+		.value = k0 + k1 * u + k2 * v + k3 * w + k4 * u * v + k5 * v * w + k6 * w * u + k7 * u * v * w,
+		// ...plus how the weights themselves shift as we move.
+		.dx = blend([](const Vector &g) { return g.x(); }) + fade_slope(fx) * (k1 + k4 * v + k6 * w + k7 * v * w),
+		.dy = blend([](const Vector &g) { return g.y(); }) + fade_slope(fy) * (k2 + k5 * w + k4 * u + k7 * w * u),
+		.dz = blend([](const Vector &g) { return g.z(); }) + fade_slope(fz) * (k3 + k6 * u + k5 * v + k7 * u * v),
+	};
+}
+
+template PerlinNoise::BasicGradient<float> PerlinNoise::get_gradient(float x, float y, float z);
+template PerlinNoise::BasicGradient<double> PerlinNoise::get_gradient(double x, double y, double z);
+
+void PerlinNoise::get_many(const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	kernel(permutation.data(), gradient_table, xs, ys, zs, out, n);
+}
+
 PerlinNoise::Vector::Vector(double x, double y, double z) 
 	: std::tuple<double, double, double>(x, y, z) { }
 
@@ -29,31 +124,17 @@ PerlinNoise::Vector PerlinNoise::Vector::sub(const Vector &v) const {
 	return Vector(x() - v.x(), y() - v.y(), z() - v.z());
 };
 
-PerlinNoise::Vector PerlinNoise::grad_vector(double x, double y, double z) {
+const PerlinNoise::Vector &PerlinNoise::grad_vector(int x, int y, int z) {
 	// To grow a seed from a single point
 	// With orderly chaos a constant we anoint
-	// But be careful not to overflow
-	// For what happens then, well, no one knows
-	double seed = 1;
-	seed = 31 * seed + x;
-	seed = 31 * seed + y;
-	seed = 31 * seed + z;
-
-	std::srand(cast<unsigned int>(seed));
-	double f_x = (double) std::rand() / RAND_MAX;
-	double f_y = (double) std::rand() / RAND_MAX;
-	double f_z = (double) std::rand() / RAND_MAX;
-
-	double mag = sqrt(f_x * f_x + f_y * f_y + f_z * f_z);
-	f_x /= mag;
-	f_y /= mag;
-	f_z /= mag;
-
-	return Vector(f_x, f_y, f_z);
+	// No reseeding the dice, no global state bent:
+	// Just a shuffle, looked up, wherever we went.
+	int hashed = permutation[(permutation[(permutation[x & 255] + y) & 255] + z) & 255];
+	return gradients[hashed % gradients.size()];
 }
 
-PerlinNoise::Vector PerlinNoise::grad_vector_from_corner(const Vector &v) {
-	return grad_vector(round(v.x()), round(v.y()), round(v.z()));
+const PerlinNoise::Vector &PerlinNoise::grad_vector_from_corner(const Vector &v) {
+	return grad_vector(cast<int>(floor(v.x())), cast<int>(floor(v.y())), cast<int>(floor(v.z())));
 }
 
 std::array<PerlinNoise::Vector, 8> PerlinNoise::cell_corners(const Vector &v) {
@@ -124,20 +205,842 @@ double PerlinNoise::interpolate(double a, double b, double w) {
 	return (b - a) * (3.0 - w * 2.0) * w * w + a;
 }
 
-double Noise::wiggle(double base, double min, double max, double step) {
-	bool up = random() < 0.5;
+// The batched kernels. All of them do the same arithmetic in the same order,
+// some a lane at a time and some four or eight, so they agree to the last bit.
+static inline float fade(float w) {
+	return (3.0f - w * 2.0f) * w * w;
+}
+
+static inline float lerp(float a, float b, float w) {
+	return (b - a) * w + a;
+}
+
+static inline int hash_corner(const int *p, int x, int y, int z) {
+	return p[(p[(p[x & 255] + y) & 255] + z) & 255];
+}
+
+static inline float grad_dot(const PerlinNoise::GradientTable &g, int h, float x, float y, float z) {
+	return x * g.x[h] + y * g.y[h] + z * g.z[h];
+}
+
+static float perlin_cell(const int *p, const PerlinNoise::GradientTable &g,
+                         int ix, int iy, int iz, int ix1, int iy1, int iz1, float fx, float fy, float fz) {
+	float d000 = grad_dot(g, hash_corner(p, ix, iy, iz), fx, fy, fz);
+	float d100 = grad_dot(g, hash_corner(p, ix1, iy, iz), fx - 1.0f, fy, fz);
+	float d010 = grad_dot(g, hash_corner(p, ix, iy1, iz), fx, fy - 1.0f, fz);
+	float d110 = grad_dot(g, hash_corner(p, ix1, iy1, iz), fx - 1.0f, fy - 1.0f, fz);
+	float d001 = grad_dot(g, hash_corner(p, ix, iy, iz1), fx, fy, fz - 1.0f);
+	float d101 = grad_dot(g, hash_corner(p, ix1, iy, iz1), fx - 1.0f, fy, fz - 1.0f);
+	float d011 = grad_dot(g, hash_corner(p, ix, iy1, iz1), fx, fy - 1.0f, fz - 1.0f);
+	float d111 = grad_dot(g, hash_corner(p, ix1, iy1, iz1), fx - 1.0f, fy - 1.0f, fz - 1.0f);
+
+	float u = fade(fx);
+	float v = fade(fy);
+	float w = fade(fz);
+
+	float bottom = lerp(lerp(d000, d100, u), lerp(d010, d110, u), v);
+	float top = lerp(lerp(d001, d101, u), lerp(d011, d111, u), v);
+
+	return lerp(bottom, top, w);
+}
+
+static float perlin_one(const int *p, const PerlinNoise::GradientTable &g, float x, float y, float z) {
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float z0 = std::floor(z);
+
+	int ix = cast<int>(x0);
+	int iy = cast<int>(y0);
+	int iz = cast<int>(z0);
+
+	return perlin_cell(p, g, ix, iy, iz, ix + 1, iy + 1, iz + 1, x - x0, y - y0, z - z0);
+}
+
+static void perlin_scalar(const int *p, const PerlinNoise::GradientTable &g,
+                          const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = perlin_one(p, g, xs[i], ys[i], zs[i]);
+	}
+}
+
+#ifdef YOK_X86
+YOK_TARGET("sse4.1") static inline __m128 fade(__m128 w) {
+	__m128 a = _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(w, _mm_set1_ps(2.0f)));
+	return _mm_mul_ps(_mm_mul_ps(a, w), w);
+}
+
+YOK_TARGET("sse4.1") static inline __m128 lerp(__m128 a, __m128 b, __m128 w) {
+	return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(b, a), w), a);
+}
+
+YOK_TARGET("sse4.1") static void perlin_sse41(const int *p, const PerlinNoise::GradientTable &g,
+                                              const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 x = _mm_loadu_ps(xs + i);
+		__m128 y = _mm_loadu_ps(ys + i);
+		__m128 z = _mm_loadu_ps(zs + i);
+
+		__m128 x0 = _mm_floor_ps(x);
+		__m128 y0 = _mm_floor_ps(y);
+		__m128 z0 = _mm_floor_ps(z);
+
+		alignas(16) int ix[4], iy[4], iz[4];
+		_mm_store_si128((__m128i *) ix, _mm_cvtps_epi32(x0));
+		_mm_store_si128((__m128i *) iy, _mm_cvtps_epi32(y0));
+		_mm_store_si128((__m128i *) iz, _mm_cvtps_epi32(z0));
+
+		// There's no gather before AVX2, so the table lookups go a lane at a time.
+		alignas(16) float gx[8][4], gy[8][4], gz[8][4];
+		for (int lane = 0; lane < 4; lane++) {
+			int h0 = p[ix[lane] & 255];
+			int h1 = p[(ix[lane] + 1) & 255];
+			int hy[4] = {
+				p[(h0 + iy[lane]) & 255],
+				p[(h1 + iy[lane]) & 255],
+				p[(h0 + iy[lane] + 1) & 255],
+				p[(h1 + iy[lane] + 1) & 255],
+			};
+
+			for (int corner = 0; corner < 8; corner++) {
+				int h = p[(hy[corner & 3] + iz[lane] + (corner >> 2)) & 255];
+				gx[corner][lane] = g.x[h];
+				gy[corner][lane] = g.y[h];
+				gz[corner][lane] = g.z[h];
+			}
+		}
+
+		__m128 fx = _mm_sub_ps(x, x0);
+		__m128 fy = _mm_sub_ps(y, y0);
+		__m128 fz = _mm_sub_ps(z, z0);
+
+		__m128 d[8];
+		for (int corner = 0; corner < 8; corner++) {
+			__m128 ox = (corner & 1) ? _mm_sub_ps(fx, one) : fx;
+			__m128 oy = ((corner >> 1) & 1) ? _mm_sub_ps(fy, one) : fy;
+			__m128 oz = (corner >> 2) ? _mm_sub_ps(fz, one) : fz;
+
+			d[corner] = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ox, _mm_load_ps(gx[corner])), _mm_mul_ps(oy, _mm_load_ps(gy[corner]))),
+				_mm_mul_ps(oz, _mm_load_ps(gz[corner]))
+			);
+		}
+
+		__m128 u = fade(fx);
+		__m128 v = fade(fy);
+		__m128 w = fade(fz);
+
+		__m128 bottom = lerp(lerp(d[0], d[1], u), lerp(d[2], d[3], u), v);
+		__m128 top = lerp(lerp(d[4], d[5], u), lerp(d[6], d[7], u), v);
+
+		_mm_storeu_ps(out + i, lerp(bottom, top, w));
+	}
+
+	perlin_scalar(p, g, xs + i, ys + i, zs + i, out + i, n - i);
+}
+
+YOK_TARGET("avx2") static inline __m256 fade(__m256 w) {
+	__m256 a = _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(w, _mm256_set1_ps(2.0f)));
+	return _mm256_mul_ps(_mm256_mul_ps(a, w), w);
+}
+
+YOK_TARGET("avx2") static inline __m256 lerp(__m256 a, __m256 b, __m256 w) {
+	return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(b, a), w), a);
+}
+
+YOK_TARGET("avx2") static inline __m256i permute(const int *p, __m256i a, __m256i b) {
+	return _mm256_i32gather_epi32(p, _mm256_and_si256(_mm256_add_epi32(a, b), _mm256_set1_epi32(255)), 4);
+}
+
+YOK_TARGET("avx2") static inline __m256 grad_dot(const PerlinNoise::GradientTable &g, __m256i h, __m256 x, __m256 y, __m256 z) {
+	__m256 gx = _mm256_i32gather_ps(g.x.data(), h, 4);
+	__m256 gy = _mm256_i32gather_ps(g.y.data(), h, 4);
+	__m256 gz = _mm256_i32gather_ps(g.z.data(), h, 4);
+
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, gx), _mm256_mul_ps(y, gy)), _mm256_mul_ps(z, gz));
+}
+
+YOK_TARGET("avx2") static void perlin_avx2(const int *p, const PerlinNoise::GradientTable &g,
+                                           const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256i one_i = _mm256_set1_epi32(1);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 z = _mm256_loadu_ps(zs + i);
+
+		__m256 x0 = _mm256_floor_ps(x);
+		__m256 y0 = _mm256_floor_ps(y);
+		__m256 z0 = _mm256_floor_ps(z);
+
+		__m256i ix = _mm256_cvtps_epi32(x0);
+		__m256i iy = _mm256_cvtps_epi32(y0);
+		__m256i iz = _mm256_cvtps_epi32(z0);
+		__m256i ix1 = _mm256_add_epi32(ix, one_i);
+		__m256i iy1 = _mm256_add_epi32(iy, one_i);
+		__m256i iz1 = _mm256_add_epi32(iz, one_i);
+
+		__m256 fx = _mm256_sub_ps(x, x0);
+		__m256 fy = _mm256_sub_ps(y, y0);
+		__m256 fz = _mm256_sub_ps(z, z0);
+		__m256 fx1 = _mm256_sub_ps(fx, one);
+		__m256 fy1 = _mm256_sub_ps(fy, one);
+		__m256 fz1 = _mm256_sub_ps(fz, one);
+
+		// The corners share most of their hashing, so only walk each branch once.
+		__m256i zero = _mm256_setzero_si256();
+		__m256i h0 = permute(p, ix, zero);
+		__m256i h1 = permute(p, ix1, zero);
+		__m256i h00 = permute(p, h0, iy);
+		__m256i h10 = permute(p, h1, iy);
+		__m256i h01 = permute(p, h0, iy1);
+		__m256i h11 = permute(p, h1, iy1);
+
+		__m256 d000 = grad_dot(g, permute(p, h00, iz), fx, fy, fz);
+		__m256 d100 = grad_dot(g, permute(p, h10, iz), fx1, fy, fz);
+		__m256 d010 = grad_dot(g, permute(p, h01, iz), fx, fy1, fz);
+		__m256 d110 = grad_dot(g, permute(p, h11, iz), fx1, fy1, fz);
+		__m256 d001 = grad_dot(g, permute(p, h00, iz1), fx, fy, fz1);
+		__m256 d101 = grad_dot(g, permute(p, h10, iz1), fx1, fy, fz1);
+		__m256 d011 = grad_dot(g, permute(p, h01, iz1), fx, fy1, fz1);
+		__m256 d111 = grad_dot(g, permute(p, h11, iz1), fx1, fy1, fz1);
+
+		__m256 u = fade(fx);
+		__m256 v = fade(fy);
+		__m256 w = fade(fz);
+
+		__m256 bottom = lerp(lerp(d000, d100, u), lerp(d010, d110, u), v);
+		__m256 top = lerp(lerp(d001, d101, u), lerp(d011, d111, u), v);
+
+		_mm256_storeu_ps(out + i, lerp(bottom, top, w));
+	}
+
+	perlin_scalar(p, g, xs + i, ys + i, zs + i, out + i, n - i);
+}
+#endif
+
+PerlinNoise::Kernel PerlinNoise::select_kernel() {
+	switch (simd_level()) {
+#ifdef YOK_X86
+		case SimdLevel::AVX2:
+			return perlin_avx2;
+		case SimdLevel::SSE41:
+			return perlin_sse41;
+#endif
+		default:
+			return perlin_scalar;
+	}
+}
+
+static void wiggle_scalar(double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		double base = values[i];
+
+		if (coins[i] < 0.5) {
+			values[i] = base + amounts[i] * (limit - base) * steps[i];
+		} else {
+			values[i] = base - amounts[i] * (base + limit) * steps[i];
+		}
+	}
+}
+
+#ifdef YOK_X86
+YOK_TARGET("sse4.1") static void wiggle_sse41(double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n) {
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d lim = _mm_set1_pd(limit);
+
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d base = _mm_loadu_pd(values + i);
+		__m128d step = _mm_loadu_pd(steps + i);
+		__m128d amount = _mm_loadu_pd(amounts + i);
+
+		__m128d up = _mm_add_pd(base, _mm_mul_pd(_mm_mul_pd(amount, _mm_sub_pd(lim, base)), step));
+		__m128d down = _mm_sub_pd(base, _mm_mul_pd(_mm_mul_pd(amount, _mm_add_pd(base, lim)), step));
+		__m128d is_up = _mm_cmplt_pd(_mm_loadu_pd(coins + i), half);
+
+		_mm_storeu_pd(values + i, _mm_blendv_pd(down, up, is_up));
+	}
+
+	wiggle_scalar(values + i, steps + i, coins + i, amounts + i, limit, n - i);
+}
+
+YOK_TARGET("avx2") static void wiggle_avx2(double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n) {
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d lim = _mm256_set1_pd(limit);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d base = _mm256_loadu_pd(values + i);
+		__m256d step = _mm256_loadu_pd(steps + i);
+		__m256d amount = _mm256_loadu_pd(amounts + i);
+
+		// Both ways at once, and then the coin decides which one sticks.
+		__m256d up = _mm256_add_pd(base, _mm256_mul_pd(_mm256_mul_pd(amount, _mm256_sub_pd(lim, base)), step));
+		__m256d down = _mm256_sub_pd(base, _mm256_mul_pd(_mm256_mul_pd(amount, _mm256_add_pd(base, lim)), step));
+		__m256d is_up = _mm256_cmp_pd(_mm256_loadu_pd(coins + i), half, _CMP_LT_OQ);
+
+		_mm256_storeu_pd(values + i, _mm256_blendv_pd(down, up, is_up));
+	}
+
+	wiggle_scalar(values + i, steps + i, coins + i, amounts + i, limit, n - i);
+}
+#endif
+
+Noise::WiggleKernel Noise::select_wiggle_kernel(SimdLevel level) {
+	switch (level) {
+#ifdef YOK_X86
+		case SimdLevel::AVX2:
+			return wiggle_avx2;
+		case SimdLevel::SSE41:
+			return wiggle_sse41;
+#endif
+		default:
+			return wiggle_scalar;
+	}
+}
+
+float PerlinNoise::get_periodic(float x, float y, float z, int period) {
+	auto wrap = [=](int i) -> int {
+		return ((i % period) + period) % period;
+	};
+
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float z0 = std::floor(z);
+
+	int ix = cast<int>(x0);
+	int iy = cast<int>(y0);
+	int iz = cast<int>(z0);
+
+	return perlin_cell(
+		permutation.data(), gradient_table,
+		wrap(ix), wrap(iy), wrap(iz), wrap(ix + 1), wrap(iy + 1), wrap(iz + 1),
+		x - x0, y - y0, z - z0
+	);
+}
+
+// Ken Perlin's reference permutation. It's hardcoded rather than shuffled at startup,
+// so the noise comes out exactly the same on every machine and every run.
+const std::array<int, 256> PerlinNoise::permutation = {
+	151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+	140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+	247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+	57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+	74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+	60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+	65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+	200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+	52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+	207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+	119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+	129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+	218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+	81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+	184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+	222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+};
+
+// The midpoints of the edges of a cube. They're scaled down so the noise keeps
+// the same spread the old rand()-seeded gradients had, or the Yonkers would get
+// a lot moodier than they used to be.
+const std::array<PerlinNoise::Vector, 12> PerlinNoise::gradients = [] {
+	const double n = 0.4;
+
+	return std::array<Vector, 12> {
+		Vector(n, n, 0.0), Vector(-n, n, 0.0), Vector(n, -n, 0.0), Vector(-n, -n, 0.0),
+		Vector(n, 0.0, n), Vector(-n, 0.0, n), Vector(n, 0.0, -n), Vector(-n, 0.0, -n),
+		Vector(0.0, n, n), Vector(0.0, -n, n), Vector(0.0, n, -n), Vector(0.0, -n, -n),
+	};
+}();
+
+const PerlinNoise::GradientTable PerlinNoise::gradient_table = [] {
+	GradientTable table;
+
+	for (int h = 0; h < 256; h++) {
+		const Vector &gradient = gradients[h % gradients.size()];
+		table.x[h] = cast<float>(gradient.x());
+		table.y[h] = cast<float>(gradient.y());
+		table.z[h] = cast<float>(gradient.z());
+	}
+
+	return table;
+}();
+
+const PerlinNoise::Kernel PerlinNoise::kernel = PerlinNoise::select_kernel();
+const Noise::WiggleKernel Noise::wiggle_kernel = Noise::select_wiggle_kernel(simd_level());
+
+#ifdef YOK_X86
+YOK_TARGET("avx2") static inline __m256 gather_at(const float *values, __m256i base, __m256i x) {
+	return _mm256_i32gather_ps(values, _mm256_add_epi32(base, x), 4);
+}
+
+// Returns how many samples it got through; the stragglers are left to the caller.
+YOK_TARGET("avx2") static size_t volume_avx2(const float *values, int size,
+                                             const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	const __m256 scale = _mm256_set1_ps(cast<float>(NoiseVolume::SamplesPerCell));
+	const __m256i mask = _mm256_set1_epi32(size - 1);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i row = _mm256_set1_epi32(size);
+	const __m256i slice = _mm256_set1_epi32(size * size);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 u = _mm256_mul_ps(_mm256_loadu_ps(xs + i), scale);
+		__m256 v = _mm256_mul_ps(_mm256_loadu_ps(ys + i), scale);
+		__m256 w = _mm256_mul_ps(_mm256_loadu_ps(zs + i), scale);
+
+		__m256 u0 = _mm256_floor_ps(u);
+		__m256 v0 = _mm256_floor_ps(v);
+		__m256 w0 = _mm256_floor_ps(w);
+
+		__m256i ix = _mm256_and_si256(_mm256_cvtps_epi32(u0), mask);
+		__m256i iy = _mm256_and_si256(_mm256_cvtps_epi32(v0), mask);
+		__m256i iz = _mm256_and_si256(_mm256_cvtps_epi32(w0), mask);
+		__m256i ix1 = _mm256_and_si256(_mm256_add_epi32(ix, one), mask);
+		__m256i iy1 = _mm256_mullo_epi32(_mm256_and_si256(_mm256_add_epi32(iy, one), mask), row);
+		__m256i iz1 = _mm256_mullo_epi32(_mm256_and_si256(_mm256_add_epi32(iz, one), mask), slice);
+		iy = _mm256_mullo_epi32(iy, row);
+		iz = _mm256_mullo_epi32(iz, slice);
+
+		__m256i b00 = _mm256_add_epi32(iz, iy);
+		__m256i b10 = _mm256_add_epi32(iz, iy1);
+		__m256i b01 = _mm256_add_epi32(iz1, iy);
+		__m256i b11 = _mm256_add_epi32(iz1, iy1);
+
+		__m256 fx = _mm256_sub_ps(u, u0);
+		__m256 fy = _mm256_sub_ps(v, v0);
+		__m256 fz = _mm256_sub_ps(w, w0);
+
+		__m256 bottom = lerp(
+			lerp(gather_at(values, b00, ix), gather_at(values, b00, ix1), fx),
+			lerp(gather_at(values, b10, ix), gather_at(values, b10, ix1), fx),
+			fy
+		);
+
+		__m256 top = lerp(
+			lerp(gather_at(values, b01, ix), gather_at(values, b01, ix1), fx),
+			lerp(gather_at(values, b11, ix), gather_at(values, b11, ix1), fx),
+			fy
+		);
+
+		_mm256_storeu_ps(out + i, lerp(bottom, top, fz));
+	}
+
+	return i;
+}
+#endif
+
+int NoiseVolume::normalized_size(int size) {
+	return cast<int>(std::bit_ceil(cast<unsigned int>(std::clamp(size, SamplesPerCell, 1 << 10))));
+}
+
+NoiseVolume::NoiseVolume(int size)
+	: m_size(normalized_size(size)),
+	  m_values(cast<size_t>(m_size) * m_size * m_size),
+	  m_has_avx2(simd_level() == SimdLevel::AVX2)
+{
+	// Bake it once, look it up forever;
+	// A fetch from a cache is ever so clever.
+	int period = m_size / SamplesPerCell;
+	float step = 1.0f / SamplesPerCell;
+
+	for (int z = 0; z < m_size; z++) {
+		for (int y = 0; y < m_size; y++) {
+			for (int x = 0; x < m_size; x++) {
+				m_values[index(x, y, z)] = PerlinNoise::get_periodic(x * step, y * step, z * step, period);
+			}
+		}
+	}
+}
+
+float NoiseVolume::get(float x, float y, float z) const {
+	float u = x * SamplesPerCell;
+	float v = y * SamplesPerCell;
+	float w = z * SamplesPerCell;
+
+	float u0 = std::floor(u);
+	float v0 = std::floor(v);
+	float w0 = std::floor(w);
+
+	int mask = m_size - 1;
+	int ix = cast<int>(u0) & mask;
+	int iy = cast<int>(v0) & mask;
+	int iz = cast<int>(w0) & mask;
+	int ix1 = (ix + 1) & mask;
+	int iy1 = (iy + 1) & mask;
+	int iz1 = (iz + 1) & mask;
+
+	float fx = u - u0;
+	float fy = v - v0;
+	float fz = w - w0;
+
+	float bottom = lerp(
+		lerp(m_values[index(ix, iy, iz)], m_values[index(ix1, iy, iz)], fx),
+		lerp(m_values[index(ix, iy1, iz)], m_values[index(ix1, iy1, iz)], fx),
+		fy
+	);
+
+	float top = lerp(
+		lerp(m_values[index(ix, iy, iz1)], m_values[index(ix1, iy, iz1)], fx),
+		lerp(m_values[index(ix, iy1, iz1)], m_values[index(ix1, iy1, iz1)], fx),
+		fy
+	);
+
+	return lerp(bottom, top, fz);
+}
+
+void NoiseVolume::get_many(const float *xs, const float *ys, const float *zs, float *out, size_t n) const {
+	size_t i = 0;
+
+#ifdef YOK_X86
+	if (m_has_avx2) {
+		i = volume_avx2(m_values.data(), m_size, xs, ys, zs, out, n);
+	}
+#endif
+
+	for (; i < n; i++) {
+		out[i] = get(xs[i], ys[i], zs[i]);
+	}
+}
+
+const NoiseVolume &NoiseVolume::shared(int size) {
+	// Once it's baked it never changes, so everyone who wants the same size may as well share.
+	static std::map<int, std::unique_ptr<const NoiseVolume>> volumes;
+	static std::mutex volumes_mutex;
+
+	std::lock_guard<std::mutex> lock(volumes_mutex);
+	std::unique_ptr<const NoiseVolume> &volume = volumes[normalized_size(size)];
+	if (!volume) {
+		volume = std::make_unique<const NoiseVolume>(size);
+	}
+
+	return *volume;
+}
+
+size_t NoiseVolume::index(int x, int y, int z) const {
+	return (cast<size_t>(z) * m_size + y) * m_size + x;
+}
+
+// Brings the spread in line with PerlinNoise, so the Yonkers feel about as strongly either way.
+constexpr static double SIMPLEX_SCALE = 48.0;
+
+// One corner's share: its gradient's pull, fading out to nothing
+// by the time we're sqrt(1/2) away, which is as far as the next simplex over.
+// The clamp is done with abs() rather than max(), which compilers like to turn back into a branch.
+template <typename T>
+static inline T simplex_corner(const PerlinNoise::GradientTable &g, int h, T x, T y, T z) {
+	T falloff = T(0.5) - x * x - y * y - z * z;
+	falloff = (falloff + std::abs(falloff)) * T(0.5);
+
+	falloff *= falloff;
+	return falloff * falloff * (x * g.x[h] + y * g.y[h] + z * g.z[h]);
+}
+
+template <typename T>
+static T simplex_one(const int *p, const PerlinNoise::GradientTable &g, T x, T y, T z) {
+	// Skew onto the cube grid to find the cell, then unskew back to find where we are in it.
+	const T skew = T(1) / T(3);
+	const T unskew = T(1) / T(6);
+
+	T s = (x + y + z) * skew;
+	T i0 = std::floor(x + s);
+	T j0 = std::floor(y + s);
+	T k0 = std::floor(z + s);
+	T u = (i0 + j0 + k0) * unskew;
+
+	T x0 = x - (i0 - u);
+	T y0 = y - (j0 - u);
+	T z0 = z - (k0 - u);
+
+	// Each cube holds six tetrahedra; the order of the offsets says which one we're in.
+	// Worked out with comparisons rather than branches, since which way they go is a coin toss.
+	int i1 = (x0 >= y0) & (x0 >= z0);
+	int j1 = (y0 > x0) & (y0 >= z0);
+	int k1 = (z0 > x0) & (z0 > y0);
+	int i2 = (x0 >= y0) | (x0 >= z0);
+	int j2 = (y0 > x0) | (y0 >= z0);
+	int k2 = (z0 > x0) | (z0 > y0);
+
+	int i = cast<int>(i0);
+	int j = cast<int>(j0);
+	int k = cast<int>(k0);
+
+	T sum = simplex_corner(g, hash_corner(p, i, j, k), x0, y0, z0)
+		+ simplex_corner(g, hash_corner(p, i + i1, j + j1, k + k1),
+		                 x0 - T(i1) + unskew, y0 - T(j1) + unskew, z0 - T(k1) + unskew)
+		+ simplex_corner(g, hash_corner(p, i + i2, j + j2, k + k2),
+		                 x0 - T(i2) + unskew * 2, y0 - T(j2) + unskew * 2, z0 - T(k2) + unskew * 2)
+		+ simplex_corner(g, hash_corner(p, i + 1, j + 1, k + 1),
+		                 x0 - T(1) + unskew * 3, y0 - T(1) + unskew * 3, z0 - T(1) + unskew * 3);
+
+	return sum * T(SIMPLEX_SCALE);
+}
+
+static void simplex_scalar(const int *p, const PerlinNoise::GradientTable &g,
+                           const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = simplex_one(p, g, xs[i], ys[i], zs[i]);
+	}
+}
+
+#ifdef YOK_X86
+YOK_TARGET("avx2") static inline __m256 simplex_corner(const PerlinNoise::GradientTable &g, __m256i h, __m256 x, __m256 y, __m256 z) {
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+
+	__m256 falloff = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(half, _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+	falloff = _mm256_mul_ps(_mm256_add_ps(falloff, _mm256_andnot_ps(sign, falloff)), half);
+
+	falloff = _mm256_mul_ps(falloff, falloff);
+	return _mm256_mul_ps(_mm256_mul_ps(falloff, falloff), grad_dot(g, h, x, y, z));
+}
+
+// Turns a comparison mask into 0 or 1, for both the hash and the offsets.
+YOK_TARGET("avx2") static inline __m256i mask_bit(__m256 mask) {
+	return _mm256_srli_epi32(_mm256_castps_si256(mask), 31);
+}
+
+YOK_TARGET("avx2") static inline __m256i hash_corner(const int *p, __m256i x, __m256i y, __m256i z) {
+	__m256i zero = _mm256_setzero_si256();
+	return permute(p, permute(p, permute(p, x, zero), y), z);
+}
+
+YOK_TARGET("avx2") static void simplex_avx2(const int *p, const PerlinNoise::GradientTable &g,
+                                            const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	const __m256 skew = _mm256_set1_ps(1.0f / 3.0f);
+	const __m256 unskew = _mm256_set1_ps(1.0f / 6.0f);
+	const __m256 unskew2 = _mm256_set1_ps(1.0f / 6.0f * 2);
+	const __m256 unskew3 = _mm256_set1_ps(1.0f / 6.0f * 3);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 scale = _mm256_set1_ps(cast<float>(SIMPLEX_SCALE));
+	const __m256i one_i = _mm256_set1_epi32(1);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 z = _mm256_loadu_ps(zs + i);
+
+		__m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), skew);
+		__m256 i0 = _mm256_floor_ps(_mm256_add_ps(x, s));
+		__m256 j0 = _mm256_floor_ps(_mm256_add_ps(y, s));
+		__m256 k0 = _mm256_floor_ps(_mm256_add_ps(z, s));
+		__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(i0, j0), k0), unskew);
+
+		__m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(i0, u));
+		__m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(j0, u));
+		__m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(k0, u));
+
+		__m256 x_ge_y = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+		__m256 x_ge_z = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+		__m256 y_gt_x = _mm256_cmp_ps(y0, x0, _CMP_GT_OQ);
+		__m256 y_ge_z = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+		__m256 z_gt_x = _mm256_cmp_ps(z0, x0, _CMP_GT_OQ);
+		__m256 z_gt_y = _mm256_cmp_ps(z0, y0, _CMP_GT_OQ);
+
+		__m256i i1 = mask_bit(_mm256_and_ps(x_ge_y, x_ge_z));
+		__m256i j1 = mask_bit(_mm256_and_ps(y_gt_x, y_ge_z));
+		__m256i k1 = mask_bit(_mm256_and_ps(z_gt_x, z_gt_y));
+		__m256i i2 = mask_bit(_mm256_or_ps(x_ge_y, x_ge_z));
+		__m256i j2 = mask_bit(_mm256_or_ps(y_gt_x, y_ge_z));
+		__m256i k2 = mask_bit(_mm256_or_ps(z_gt_x, z_gt_y));
+
+		__m256i ii = _mm256_cvtps_epi32(i0);
+		__m256i jj = _mm256_cvtps_epi32(j0);
+		__m256i kk = _mm256_cvtps_epi32(k0);
+
+		__m256 n0 = simplex_corner(g, hash_corner(p, ii, jj, kk), x0, y0, z0);
+
+		__m256 n1 = simplex_corner(g,
+			hash_corner(p, _mm256_add_epi32(ii, i1), _mm256_add_epi32(jj, j1), _mm256_add_epi32(kk, k1)),
+			_mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(i1)), unskew),
+			_mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(j1)), unskew),
+			_mm256_add_ps(_mm256_sub_ps(z0, _mm256_cvtepi32_ps(k1)), unskew));
+
+		__m256 n2 = simplex_corner(g,
+			hash_corner(p, _mm256_add_epi32(ii, i2), _mm256_add_epi32(jj, j2), _mm256_add_epi32(kk, k2)),
+			_mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(i2)), unskew2),
+			_mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(j2)), unskew2),
+			_mm256_add_ps(_mm256_sub_ps(z0, _mm256_cvtepi32_ps(k2)), unskew2));
+
+		__m256 n3 = simplex_corner(g,
+			hash_corner(p, _mm256_add_epi32(ii, one_i), _mm256_add_epi32(jj, one_i), _mm256_add_epi32(kk, one_i)),
+			_mm256_add_ps(_mm256_sub_ps(x0, one), unskew3),
+			_mm256_add_ps(_mm256_sub_ps(y0, one), unskew3),
+			_mm256_add_ps(_mm256_sub_ps(z0, one), unskew3));
+
+		__m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), n3);
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(sum, scale));
+	}
+
+	simplex_scalar(p, g, xs + i, ys + i, zs + i, out + i, n - i);
+}
+#endif
+
+double SimplexNoise::get(double x, double y, double z) {
+	return simplex_one(PerlinNoise::permutation.data(), PerlinNoise::gradient_table, x, y, z);
+}
+
+void SimplexNoise::get_many(const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	kernel(PerlinNoise::permutation.data(), PerlinNoise::gradient_table, xs, ys, zs, out, n);
+}
+
+PerlinNoise::Kernel SimplexNoise::select_kernel() {
+	switch (simd_level()) {
+#ifdef YOK_X86
+		case SimdLevel::AVX2:
+			return simplex_avx2;
+#endif
+		default:
+			return simplex_scalar;
+	}
+}
+
+const PerlinNoise::Kernel SimplexNoise::kernel = SimplexNoise::select_kernel();
+
+void NoiseField::get_many(NoiseEngine engine, int volume_size,
+                          const float *xs, const float *ys, const float *zs, float *out, size_t n) {
+	switch (engine) {
+		case NoiseEngine::Volume:
+			NoiseVolume::shared(volume_size).get_many(xs, ys, zs, out, n);
+			break;
+		case NoiseEngine::Simplex:
+			SimplexNoise::get_many(xs, ys, zs, out, n);
+			break;
+		default:
+			PerlinNoise::get_many(xs, ys, zs, out, n);
+			break;
+	}
+}
+
+double Noise::wiggle(Random &rng, double base, double min, double max, double step) {
+	bool up = random(rng) < 0.5;
 
 	if (up) {
-		return base + random() * (max - base) * step;
+		return base + random(rng) * (max - base) * step;
 	} else {
-		return base - random() * (base - min) * step;
+		return base - random(rng) * (base - min) * step;
 	}
 }
 
-double Noise::random() {
-	static std::random_device device;
-	static std::mt19937 rng(device());
-	static std::uniform_real_distribution<> dist(0.0, 1.0);
+void Noise::wiggle_many(double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n) {
+	wiggle_kernel(values, steps, coins, amounts, limit, n);
+}
+
+void Noise::wiggle_many(SimdLevel level, double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n) {
+	select_wiggle_kernel(level)(values, steps, coins, amounts, limit, n);
+}
+
+double Noise::random(Random &rng) {
+	return rng.uniform();
+}
+
+RandomStreams::RandomStreams() {
+	seed(cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+}
+
+Random &RandomStreams::get(RandomStream stream) {
+	return m_streams[(size_t) stream];
+}
+
+void RandomStreams::seed(uint64_t seed) {
+	m_seed = seed;
+
+	Random root(seed);
+	for (Random &stream : m_streams) {
+		stream = root.split();
+	}
+}
+
+uint64_t RandomStreams::session_seed() const {
+	return m_seed;
+}
+
+Random::Random(uint64_t seed) {
+	// splitmix64, so that even a seed of 0 gives a healthy state.
+	for (uint64_t &word : m_state) {
+		seed += 0x9e3779b97f4a7c15;
+
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		word = z ^ (z >> 31);
+	}
+}
+
+uint64_t Random::next() {
+	uint64_t result = std::rotl(m_state[1] * 5, 7) * 9;
+	uint64_t t = m_state[1] << 17;
+
+	m_state[2] ^= m_state[0];
+	m_state[3] ^= m_state[1];
+	m_state[1] ^= m_state[2];
+	m_state[0] ^= m_state[3];
+
+	m_state[2] ^= t;
+	m_state[3] = std::rotl(m_state[3], 45);
+
+	return result;
+}
+
+uint64_t Random::operator()() {
+	return next();
+}
+
+double Random::uniform() {
+	return cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+uint32_t Random::below(uint32_t n) {
+	// Lemire's multiply-and-shift; the bias is far too small to matter here.
+	return cast<uint32_t>(((next() >> 32) * n) >> 32);
+}
+
+void Random::fill(double *out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = uniform();
+	}
+}
+
+void Random::fill(float *out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = cast<float>(next() >> 40) * 0x1.0p-24f;
+	}
+}
+
+Random Random::split() {
+	Random child = *this;
+	jump();
+	return child;
+}
+
+const Random::State &Random::state() const {
+	return m_state;
+}
+
+void Random::set_state(const State &state) {
+	m_state = state;
+}
+
+void Random::jump() {
+	constexpr uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+
+	std::array<uint64_t, 4> jumped = { 0, 0, 0, 0 };
+	for (uint64_t bits : JUMP) {
+		for (int b = 0; b < 64; b++) {
+			if (bits & (1ull << b)) {
+				for (size_t i = 0; i < jumped.size(); i++) {
+					jumped[i] ^= m_state[i];
+				}
+			}
+			next();
+		}
+	}
 
-	return dist(rng);
+	m_state = jumped;
 }
\ No newline at end of file
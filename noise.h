@@ -3,6 +3,12 @@
 #include <tuple>
 #include <random>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// From simd.h, which the callers that pick a level include themselves.
+enum class SimdLevel;
 
 // The student says, this already is done!
 // To make something worse, it's absurd, what is won?
@@ -12,6 +18,34 @@ class PerlinNoise {
 public:
 	static double get(double x, double y, double z);
 
+	// The noise at a point, along with its gradient there.
+	template <typename T> struct BasicGradient {
+		T value;
+		T dx;
+		T dy;
+		T dz;
+	};
+	using Gradient = BasicGradient<double>;
+
+	// Same value as get(), but the derivatives come along analytically,
+	// for about the price of one evaluation rather than the four or more
+	// finite differences would need. There's a float and a double version.
+	template <typename T> static BasicGradient<T> get_gradient(T x, T y, T z);
+
+	// Samples n points at once, in single precision. Picks the widest SIMD kernel
+	// the CPU supports, so prefer this over get() when there's a whole crowd to do.
+	static void get_many(const float *xs, const float *ys, const float *zs, float *out, size_t n);
+
+	// Like get(), but repeats itself every period cells along each axis.
+	static float get_periodic(float x, float y, float z, int period);
+
+	// The gradients, ready for indexing with a fully hashed corner.
+	struct GradientTable {
+		std::array<float, 256> x;
+		std::array<float, 256> y;
+		std::array<float, 256> z;
+	};
+
 private:
 	class Vector : public std::tuple<double, double, double> {
 	public:
@@ -25,17 +59,171 @@ private:
 		                                   // One will only choose what they think that they should
 	};
 
-	static Vector grad_vector(double x, double y, double z);
-	static Vector grad_vector_from_corner(const Vector &v);
+	static const Vector &grad_vector(int x, int y, int z);
+	static const Vector &grad_vector_from_corner(const Vector &v);
 	static std::array<Vector, 8> cell_corners(const Vector &v);
 	static std::array<Vector, 8> offset_vectors(const Vector &v);
 	static std::array<double, 8> cell_dots(const Vector &v);
 	static double cell_interpolate(std::array<double, 8> dots, const Vector &v);
 	static double interpolate(double a, double b, double w);
+
+	using Kernel = void (*)(const int *permutation, const GradientTable &gradients,
+	                        const float *xs, const float *ys, const float *zs, float *out, size_t n);
+	static Kernel select_kernel();
+
+	static const std::array<int, 256> permutation;
+	static const std::array<Vector, 12> gradients;
+	static const GradientTable gradient_table;
+	static const Kernel kernel;
+
+	friend class SimplexNoise;
+};
+
+// Ken Perlin's other noise: the space is cut into tetrahedra instead of cubes,
+// so each sample only visits 4 corners instead of 8. It borrows PerlinNoise's
+// permutation and gradients, and is scaled to about the same spread.
+class SimplexNoise {
+public:
+	static double get(double x, double y, double z);
+	static void get_many(const float *xs, const float *ys, const float *zs, float *out, size_t n);
+
+private:
+	static PerlinNoise::Kernel select_kernel();
+
+	static const PerlinNoise::Kernel kernel;
+};
+
+// Perlin noise baked into a tileable grid of size^3 floats, sampled with
+// trilinear interpolation. It costs a handful of memory fetches per sample
+// instead of a full evaluation, and repeats every size / SamplesPerCell cells.
+class NoiseVolume {
+public:
+	constexpr static int SamplesPerCell = 4;
+
+	// The size gets rounded up to a power of two.
+	NoiseVolume(int size);
+
+	float get(float x, float y, float z) const;
+	void get_many(const float *xs, const float *ys, const float *zs, float *out, size_t n) const;
+
+	// Sizes that round up to the same one share the same volume.
+	static const NoiseVolume &shared(int size);
+
+private:
+	// What size actually gets built for a size asked for.
+	static int normalized_size(int size);
+
+	size_t index(int x, int y, int z) const;
+
+	int m_size;
+	std::vector<float> m_values;
+	bool m_has_avx2;
+};
+
+enum class NoiseEngine {
+	Perlin = 0,
+	Volume = 1,
+	Simplex = 2,
+};
+
+// Whichever engine was asked for, behind the one call.
+class NoiseField {
+public:
+	// The volume engine bakes a volume_size^3 grid the first time it's used; see NoiseVolume::shared.
+	static void get_many(NoiseEngine engine, int volume_size,
+	                     const float *xs, const float *ys, const float *zs, float *out, size_t n);
+};
+
+// xoshiro256**, seeded through splitmix64. Small, quick, and the same on every
+// platform, so a session can be replayed from nothing but its seed.
+// It's a UniformRandomBitGenerator, so it'll also plug into <algorithm> and <random>.
+class Random {
+public:
+	using result_type = uint64_t;
+	using State = std::array<uint64_t, 4>;
+
+	Random(uint64_t seed = 0);
+
+	uint64_t next();
+	uint64_t operator()();
+
+	// In [0, 1).
+	double uniform();
+	// In [0, n).
+	uint32_t below(uint32_t n);
+
+	void fill(double *out, size_t n);
+	void fill(float *out, size_t n);
+
+	// Hands back a generator for the current stream, and skips this one
+	// 2^128 draws ahead, so the two will never overlap.
+	Random split();
+
+	// Everything it'll ever draw follows from this, so it's all a snapshot needs to keep.
+	const State &state() const;
+	void set_state(const State &state);
+
+	// Parenthesized so windows.h's min and max macros leave them alone.
+	static constexpr result_type (min)() {
+		return 0;
+	}
+
+	static constexpr result_type (max)() {
+		return UINT64_MAX;
+	}
+
+private:
+	void jump();
+
+	State m_state;
+};
+
+// Every subsystem draws from its own stream, so one of them drawing more or
+// less than usual doesn't shuffle everyone else's luck.
+enum class RandomStream {
+	General,
+	Sprites,
+	Palettes,
+	Patterns,
+	_STREAM_COUNT
+};
+
+// Every stream one session draws from, all split off the same seed. Each Context keeps
+// its own, so sessions running side by side never draw from each other's luck.
+class RandomStreams {
+public:
+	// Seeded from the clock until seed() says otherwise.
+	RandomStreams();
+
+	// The streams are not thread-safe; a thread that wants its own should split() it off.
+	Random &get(RandomStream stream = RandomStream::General);
+
+	// Reseeds every stream.
+	void seed(uint64_t seed);
+	uint64_t session_seed() const;
+
+private:
+	std::array<Random, (size_t) RandomStream::_STREAM_COUNT> m_streams;
+	uint64_t m_seed;
 };
 
 class Noise {
 public:
-	static double wiggle(double base, double min, double max, double step);
-	static double random();
+	static double wiggle(Random &rng, double base, double min, double max, double step);
+
+	// wiggle() for a whole batch, between -limit and limit, with the same odds.
+	// Each value takes two draws from random(): coins[i] picks the direction
+	// and amounts[i] how far, exactly as wiggle() would use them.
+	static void wiggle_many(double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n);
+	// The same on one particular path rather than the best this CPU has, so the bench
+	// can hold each of them to wiggle(). Only ask for levels simd_level() allows.
+	static void wiggle_many(SimdLevel level, double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n);
+
+	static double random(Random &rng);
+
+private:
+	using WiggleKernel = void (*)(double *values, const double *steps, const double *coins, const double *amounts, double limit, size_t n);
+	static WiggleKernel select_wiggle_kernel(SimdLevel level);
+
+	static const WiggleKernel wiggle_kernel;
 };
\ No newline at end of file
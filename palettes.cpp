@@ -5,11 +5,12 @@
 #include <string>
 #include <codecvt>
 #include <locale>
+#include <cwchar>
 
 #include "palettes.h"
+#include "noise.h"
 #include "common.h"
 #include "config.h"
-#include "configdialog.h"
 
 PaletteData::PaletteData(const std::array<Color, _PALETTE_SIZE> &colors) {
 	std::copy(colors.begin(), colors.end(), begin());
@@ -33,31 +34,25 @@ PaletteData::PaletteData(const std::vector<std::wstring> &hex_strings) {
 	});
 }
 
-Palettes::Definition RandomPalettes::random(int rng_token) {
-	static std::map<int, PaletteData *> generated_palettes;
+RandomPalettes::RandomPalettes(Random &rng) : m_rng(rng) {
+	int bias_intensity = (int) (20.0 / ((cfg[Cfg::MaxColors] + 4.0) / Cfg::MaxColors.range.second));
 
-	auto result = generated_palettes.find(rng_token);
-
-	if (result == generated_palettes.end()) {
-		generated_palettes[rng_token] = new_random_palette();
-	}
+	m_red_bias = roll(bias_intensity) * (roll(2) ? -1.0 : 1.0);
+	m_green_bias = roll(bias_intensity) * (roll(2) ? -1.0 : 1.0);
+	m_blue_bias = roll(bias_intensity) * (roll(2) ? -1.0 : 1.0);
+}
 
+Palettes::Definition RandomPalettes::random() {
 	Palettes::Definition palette = {
 		.name = L"random",
 		.group = PaletteGroup::RandomlyGenerated,
-		.data = generated_palettes.at(rng_token)
+		.data = new_random_palette()
 	};
 
 	return palette;
 }
 
 PaletteData *RandomPalettes::new_random_palette() {
-	static int bias_intensity = (int) (20.0 / ((cfg[Cfg::MaxColors] + 4.0) / Cfg::MaxColors.range.second));
-
-	static double red_bias = rand() % bias_intensity * (rand() % 2 ? -1.0 : 1.0);
-	static double green_bias = rand() % bias_intensity * (rand() % 2 ? -1.0 : 1.0);
-	static double blue_bias = rand() % bias_intensity * (rand() % 2 ? -1.0 : 1.0);
-
 	std::array<Color, _PALETTE_SIZE> colors;
 
 	colors[PI_SCALES] = random_color();
@@ -66,7 +61,7 @@ PaletteData *RandomPalettes::new_random_palette() {
 
 	for (auto &color : colors) {
 		color = noisify(color, 15.0f);
-		color = recolorize(color, red_bias, green_bias, blue_bias);
+		color = recolorize(color, m_red_bias, m_green_bias, m_blue_bias);
 	}
 
 	colors[PI_WHITES] = { 240, 240, 240, 255 };
@@ -108,12 +103,12 @@ PaletteData *RandomPalettes::new_random_palette() {
 
 Color RandomPalettes::random_color() {
 	std::vector<int> values = { 
-		rand() % 50,
-		225 - rand() % 50,
-		rand() % 225
+		roll(50),
+		225 - roll(50),
+		roll(225)
 	};
 
-	std::shuffle(values.begin(), values.end(), std::mt19937(std::random_device()()));
+	std::shuffle(values.begin(), values.end(), m_rng);
 
 	return {
 		values[0],
@@ -124,7 +119,7 @@ Color RandomPalettes::random_color() {
 }
 
 Color RandomPalettes::random_gray() {
-	int luminance = rand() % 255;
+	int luminance = roll(255);
 	return { luminance, luminance, luminance, 255 };
 }
 
@@ -155,9 +150,9 @@ Color RandomPalettes::lighten_color(const Color &color) {
 }
 
 Color RandomPalettes::noisify(const Color &color, double degree) {
-	double new_red = std::get<RED>(color) + (((rand() % 100) / 100.0) * degree);
-	double new_green = std::get<GREEN>(color) + (((rand() % 100) / 100.0) * degree);
-	double new_blue = std::get<BLUE>(color) + (((rand() % 100) / 100.0) * degree);
+	double new_red = std::get<RED>(color) + ((roll(100) / 100.0) * degree);
+	double new_green = std::get<GREEN>(color) + ((roll(100) / 100.0) * degree);
+	double new_blue = std::get<BLUE>(color) + ((roll(100) / 100.0) * degree);
 
 	return {
 		std::clamp(cast<int>(new_red), 0, 255),
@@ -168,9 +163,9 @@ Color RandomPalettes::noisify(const Color &color, double degree) {
 }
 
 Color RandomPalettes::recolorize(const Color &color, double red_weight, double green_weight, double blue_weight) {
-	double new_red = std::get<RED>(color) + (rand() % 100 / 50.0) * red_weight;
-	double new_green = std::get<GREEN>(color) + (rand() % 100 / 50.0) * green_weight;
-	double new_blue = std::get<BLUE>(color) + (rand() % 100 / 50.0) * blue_weight;
+	double new_red = std::get<RED>(color) + (roll(100) / 50.0) * red_weight;
+	double new_green = std::get<GREEN>(color) + (roll(100) / 50.0) * green_weight;
+	double new_blue = std::get<BLUE>(color) + (roll(100) / 50.0) * blue_weight;
 
 	return {
 		std::clamp(cast<int>(new_red), 0, 255),
@@ -180,27 +175,33 @@ Color RandomPalettes::recolorize(const Color &color, double red_weight, double g
 	};
 }
 
+int RandomPalettes::roll(int sides) {
+	return cast<int>(m_rng.below(cast<uint32_t>(sides)));
+}
+
 std::set<RandomPalettes::GenerationTraits> RandomPalettes::random_traits() {
-	auto random_inverse_falloff_percent = [](double scale) -> double {
-		if (rand() % 50 == 0) {
+	auto random_inverse_falloff_percent = [&](double scale) -> double {
+		if (roll(50) == 0) {
 			return 1.0; // Very ocassionally, a trait will have 100% chance
 		}
 
-		return 1.0 / ((rand() % 300 / 100.0 + 2) + 0.25) * scale;
+		return 1.0 / ((roll(300) / 100.0 + 2) + 0.25) * scale;
 	};
 
-	const static std::map<GenerationTraits, double> trait_chances = {
-		{ GenerationTraits::ColorfulHorns, random_inverse_falloff_percent(0.7) },
-		{ GenerationTraits::SwapHornsAndScales, random_inverse_falloff_percent(0.4) },
-		{ GenerationTraits::BlackEyes, random_inverse_falloff_percent(0.2) },
-		{ GenerationTraits::PastelScales, random_inverse_falloff_percent(0.3) },
-		{ GenerationTraits::CrystalBody, random_inverse_falloff_percent(0.2) },
-	};
+	if (m_trait_chances.empty()) {
+		m_trait_chances = {
+			{ GenerationTraits::ColorfulHorns, random_inverse_falloff_percent(0.7) },
+			{ GenerationTraits::SwapHornsAndScales, random_inverse_falloff_percent(0.4) },
+			{ GenerationTraits::BlackEyes, random_inverse_falloff_percent(0.2) },
+			{ GenerationTraits::PastelScales, random_inverse_falloff_percent(0.3) },
+			{ GenerationTraits::CrystalBody, random_inverse_falloff_percent(0.2) },
+		};
+	}
 
 	std::set<GenerationTraits> traits;
 
-	for (const auto &pair : trait_chances) {
-		if (rand() % 100 / 100.0 < pair.second) {
+	for (const auto &pair : m_trait_chances) {
+		if (roll(100) / 100.0 < pair.second) {
 			traits.insert(pair.first);
 		}
 	}
@@ -268,7 +269,9 @@ std::wstring PaletteRepository::serialize(const PaletteData &palette) {
 
 	for (size_t i = 1; i < palette.size(); i++) {
 		auto color = palette[i];
-		serialized += std::format(L"#{:0>2x}{:0>2x}{:0>2x};", std::get<RED>(color), std::get<GREEN>(color), std::get<BLUE>(color));
+		wchar_t hex[16];
+		swprintf(hex, 16, L"#%02x%02x%02x;", std::get<RED>(color), std::get<GREEN>(color), std::get<BLUE>(color));
+		serialized += hex;
 	}
 
 	return serialized.substr(0, serialized.size() - 1);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <map>
 #include <set>
 #include <initializer_list>
 #include <vector>
@@ -11,6 +12,7 @@
 
 #include "common.h"
 #include "config.h"
+#include "noise.h"
 
 enum PaletteIndex {
 	PI_TRANSPARENT = 0,      
@@ -757,9 +759,14 @@ struct Palettes {
 	};
 };
 
+// Makes palettes up on the spot. Everything one of these makes leans the same way
+// and has the same odds for each trait, so a session's palettes look like they belong together.
 class RandomPalettes {
 public:
-	static Palettes::Definition random(int rng_token);
+	RandomPalettes(Random &rng);
+
+	// A new palette every time. It stays around for good, since textures are made from it.
+	Palettes::Definition random();
 
 private:
 	enum class GenerationTraits {
@@ -770,14 +777,22 @@ private:
 		CrystalBody,
 	};
 
-	static PaletteData *new_random_palette();
-	static Color random_color();
-	static Color random_gray();
+	PaletteData *new_random_palette();
+	Color random_color();
+	Color random_gray();
 	static Color darken_color(const Color &color);
 	static Color lighten_color(const Color &color);
-	static Color noisify(const Color &color, double degree = 1.0);
-	static Color recolorize(const Color &color, double red_weight, double green_weight, double blue_weight);
-	static std::set<GenerationTraits> random_traits();
+	Color noisify(const Color &color, double degree = 1.0);
+	Color recolorize(const Color &color, double red_weight, double green_weight, double blue_weight);
+	std::set<GenerationTraits> random_traits();
+	int roll(int sides);
+
+	Random &m_rng;
+	double m_red_bias;
+	double m_green_bias;
+	double m_blue_bias;
+	// Drawn the first time they're needed.
+	std::map<GenerationTraits, double> m_trait_chances;
 };
 
 struct PaletteGroups {
@@ -0,0 +1,84 @@
+#pragma once
+
+// Whatever the simulation needs from Windows and OpenGL comes in through here.
+//
+// Build with YOK_HEADLESS and it gets just enough of both to compile and run
+// with no window, no registry and nothing to draw on: the GL calls do nothing,
+// and there's a rectangle to pretend is the screen. That's what yokscr-bench uses.
+#ifndef YOK_HEADLESS
+
+#include <windows.h>
+#include <gl/GL.h>
+#include <gl/GLU.h>
+
+#else
+
+#include <atomic>
+#include <cstdint>
+
+using HWND = void *;
+using HDC = void *;
+using HGLRC = void *;
+using HANDLE = void *;
+using HKEY = void *;
+using BYTE = unsigned char;
+using BOOL = int;
+using LONG = long;
+using DWORD = unsigned long;
+
+struct RECT {
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+using GLubyte = unsigned char;
+using GLuint = unsigned int;
+using GLint = int;
+using GLenum = unsigned int;
+using GLsizei = int;
+using GLfloat = float;
+using GLdouble = double;
+
+constexpr GLenum GL_LINE_LOOP = 0x0002;
+constexpr GLenum GL_QUADS = 0x0007;
+constexpr GLenum GL_SRC_ALPHA = 0x0302;
+constexpr GLenum GL_ONE_MINUS_SRC_ALPHA = 0x0303;
+constexpr GLenum GL_BLEND = 0x0BE2;
+constexpr GLenum GL_TEXTURE_2D = 0x0DE1;
+constexpr GLenum GL_UNSIGNED_BYTE = 0x1401;
+constexpr GLenum GL_RGBA = 0x1908;
+constexpr GLenum GL_NEAREST = 0x2600;
+constexpr GLenum GL_TEXTURE_MAG_FILTER = 0x2800;
+constexpr GLenum GL_TEXTURE_MIN_FILTER = 0x2801;
+constexpr GLenum GL_TEXTURE_WRAP_S = 0x2802;
+constexpr GLenum GL_TEXTURE_WRAP_T = 0x2803;
+constexpr GLenum GL_CLAMP = 0x2900;
+constexpr GLenum GL_RGBA8 = 0x8058;
+
+// Nobody's watching, so there's nothing to draw.
+// Textures still get ids, so they know they've been "uploaded".
+inline void glGenTextures(GLsizei n, GLuint *textures) {
+	static std::atomic<GLuint> next_id = 1;
+	for (GLsizei i = 0; i < n; i++) {
+		textures[i] = next_id++;
+	}
+}
+
+inline void glBindTexture(GLenum, GLuint) { }
+inline void glTexParameterf(GLenum, GLenum, GLfloat) { }
+inline void glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void *) { }
+inline void glEnable(GLenum) { }
+inline void glBlendFunc(GLenum, GLenum) { }
+inline void glColor4d(GLdouble, GLdouble, GLdouble, GLdouble) { }
+inline void glPushMatrix() { }
+inline void glPopMatrix() { }
+inline void glTranslated(GLdouble, GLdouble, GLdouble) { }
+inline void glScaled(GLdouble, GLdouble, GLdouble) { }
+inline void glBegin(GLenum) { }
+inline void glEnd() { }
+inline void glTexCoord2d(GLdouble, GLdouble) { }
+inline void glVertex2d(GLdouble, GLdouble) { }
+
+#endif
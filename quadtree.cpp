@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "quadtree.h"
+
+void QuadTree::split() {
+	size_t n = m_xs.size();
+
+	// Anyone who isn't anywhere can't pull on anyone, so they're left out altogether.
+	m_order.clear();
+	for (size_t i = 0; i < n; i++) {
+		if (std::isfinite(m_xs[i]) && std::isfinite(m_ys[i])) {
+			m_order.push_back(cast<uint32_t>(i));
+		}
+	}
+
+	// The square around everyone else.
+	Real left = 0, right = 0, top = 0, bottom = 0;
+	if (!m_order.empty()) {
+		left = right = m_xs[m_order[0]];
+		top = bottom = m_ys[m_order[0]];
+	}
+	for (uint32_t i : m_order) {
+		left = (std::min)(left, m_xs[i]);
+		right = (std::max)(right, m_xs[i]);
+		top = (std::min)(top, m_ys[i]);
+		bottom = (std::max)(bottom, m_ys[i]);
+	}
+
+	Real width = (std::max)(right - left, bottom - top);
+	if (!(width > 0) || !std::isfinite(width)) {
+		width = 1;
+	}
+
+	m_nodes.clear();
+	m_nodes.push_back({ 0, 0, 0, width, 0, cast<uint32_t>(m_order.size()), NO_CHILDREN });
+	split_node(0, left, top, width, 0);
+
+	m_order_xs.resize(m_order.size());
+	m_order_ys.resize(m_order.size());
+	for (size_t k = 0; k < m_order.size(); k++) {
+		m_order_xs[k] = m_xs[m_order[k]];
+		m_order_ys[k] = m_ys[m_order[k]];
+	}
+}
+
+void QuadTree::split_node(uint32_t node, Real left, Real top, Real width, int depth) {
+	uint32_t first = m_nodes[node].first;
+	uint32_t last = m_nodes[node].last;
+
+	if (last - first <= LEAF_SIZE || depth >= MAX_DEPTH) {
+		Real sum_x = 0, sum_y = 0;
+		for (uint32_t k = first; k < last; k++) {
+			sum_x += m_xs[m_order[k]];
+			sum_y += m_ys[m_order[k]];
+		}
+
+		Real mass = cast<Real>(last - first);
+		m_nodes[node].mass = mass;
+		m_nodes[node].mass_x = mass > 0 ? sum_x / mass : left + width / 2;
+		m_nodes[node].mass_y = mass > 0 ? sum_y / mass : top + width / 2;
+		return;
+	}
+
+	Real half = width / 2;
+	Real middle_x = left + half;
+	Real middle_y = top + half;
+
+	// Top half before bottom, then left before right within each.
+	auto begin = m_order.begin();
+	auto above = [&](uint32_t i) { return m_ys[i] < middle_y; };
+	auto leftward = [&](uint32_t i) { return m_xs[i] < middle_x; };
+
+	uint32_t split_y = cast<uint32_t>(std::partition(begin + first, begin + last, above) - begin);
+	uint32_t split_top = cast<uint32_t>(std::partition(begin + first, begin + split_y, leftward) - begin);
+	uint32_t split_bottom = cast<uint32_t>(std::partition(begin + split_y, begin + last, leftward) - begin);
+
+	// The quarters go in one after the other, so the node only needs to know where the first is.
+	uint32_t children = cast<uint32_t>(m_nodes.size());
+	m_nodes[node].children = children;
+
+	const std::array<uint32_t, 5> bounds = { first, split_top, split_y, split_bottom, last };
+	for (uint32_t q = 0; q < 4; q++) {
+		m_nodes.push_back({ 0, 0, 0, half, bounds[q], bounds[q + 1], NO_CHILDREN });
+	}
+
+	for (uint32_t q = 0; q < 4; q++) {
+		split_node(children + q, left + (q & 1 ? half : 0), top + (q & 2 ? half : 0), half, depth + 1);
+	}
+
+	// m_nodes may have moved while the quarters were split, so nothing's held on to across that.
+	Real mass = 0, sum_x = 0, sum_y = 0;
+	for (uint32_t q = 0; q < 4; q++) {
+		const Node &child = m_nodes[children + q];
+		mass += child.mass;
+		sum_x += child.mass_x * child.mass;
+		sum_y += child.mass_y * child.mass;
+	}
+
+	m_nodes[node].mass = mass;
+	m_nodes[node].mass_x = sum_x / mass;
+	m_nodes[node].mass_y = sum_y / mass;
+}
+
+QuadTree::Pull QuadTree::pull(Real x, Real y, Real opening_angle, Real softening) const {
+	Pull pull = { 0, 0 };
+	if (m_nodes.empty()) {
+		return pull;
+	}
+
+	const Real softening_sq = softening * softening;
+	const Real opening_sq = opening_angle * opening_angle;
+
+	auto add = [&](Real dist_x, Real dist_y, Real mass) {
+		Real dist_sq = dist_x * dist_x + dist_y * dist_y + softening_sq;
+		Real strength = mass / (dist_sq * std::sqrt(dist_sq));
+		pull.x += dist_x * strength;
+		pull.y += dist_y * strength;
+	};
+
+	// Every pop pushes at most four, so the stack never gets deeper than three per level, plus the last four.
+	std::array<uint32_t, MAX_DEPTH * 3 + 4> stack;
+	size_t top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const Node &node = m_nodes[stack[--top]];
+		if (node.mass == 0) {
+			continue;
+		}
+
+		if (node.children == NO_CHILDREN) {
+			for (uint32_t k = node.first; k < node.last; k++) {
+				add(m_order_xs[k] - x, m_order_ys[k] - y, 1);
+			}
+			continue;
+		}
+
+		Real dist_x = node.mass_x - x;
+		Real dist_y = node.mass_y - y;
+		if (node.width * node.width < opening_sq * (dist_x * dist_x + dist_y * dist_y)) {
+			add(dist_x, dist_y, node.mass);
+			continue;
+		}
+
+		// Backwards, so the top-left quarter comes off first.
+		for (uint32_t q = 4; q > 0; q--) {
+			stack[top++] = node.children + q - 1;
+		}
+	}
+
+	return pull;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+// Barnes-Hut: splits the plane into quarters, and those into quarters, until each
+// piece only holds a few points, and keeps how much is in each piece and where its
+// middle of mass is. From far enough away, a whole piece pulls like one point at
+// that middle, so adding up the pull on a point only takes a look at a few pieces
+// near it and a few big ones further out, instead of at everyone.
+//
+// The pieces are built the same way from the same points every time and looked at
+// in the same order, so what comes out depends only on what went in. Once built,
+// any number of threads can ask it things at once.
+class QuadTree {
+public:
+	struct Pull {
+		Real x;
+		Real y;
+	};
+
+	// Takes everyone's position from position(i), for i in [0, n), each weighing the same.
+	// The nodes are kept from one build to the next.
+	template <typename Position> void build(size_t n, Position &&position) {
+		m_xs.resize(n);
+		m_ys.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			auto [x, y] = position(i);
+			m_xs[i] = x;
+			m_ys[i] = y;
+		}
+
+		split();
+	}
+
+	// The pull on (x, y) from everyone, each weighing 1, as if the strength were 1 and
+	// nobody were ever closer than softening; it's up to the caller to scale it.
+	// A piece counts as one point once its width is less than opening_angle times
+	// its distance; 0 looks at every point, exactly. If (x, y) is one of the points,
+	// softening has to be above 0, or it pulls on itself infinitely hard.
+	Pull pull(Real x, Real y, Real opening_angle, Real softening) const;
+
+	size_t size() const {
+		return m_xs.size();
+	}
+
+	// Where build() put point i.
+	Real x(size_t i) const {
+		return m_xs[i];
+	}
+
+	Real y(size_t i) const {
+		return m_ys[i];
+	}
+
+private:
+	// Pieces with this few points in them don't get split any further.
+	constexpr static uint32_t LEAF_SIZE = 8;
+	// Points that sit right on top of each other can't ever be split apart, so stop somewhere.
+	constexpr static int MAX_DEPTH = 32;
+
+	struct Node {
+		// Where the middle of its mass is, and how much of it there is.
+		Real mass_x;
+		Real mass_y;
+		Real mass;
+		// How wide the square is.
+		Real width;
+		// Its points are m_order[first] up to m_order[last].
+		uint32_t first;
+		uint32_t last;
+		// Its four quarters are m_nodes[children] onwards; a leaf has none.
+		uint32_t children;
+	};
+
+	constexpr static uint32_t NO_CHILDREN = 0;
+
+	void split();
+	void split_node(uint32_t node, Real left, Real top, Real width, int depth);
+
+	std::vector<Real> m_xs;
+	std::vector<Real> m_ys;
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_order;
+	// Each point's coordinates again, in m_order's order, so a leaf's points are read straight through.
+	std::vector<Real> m_order_xs;
+	std::vector<Real> m_order_ys;
+};
@@ -0,0 +1,345 @@
+#include <cstring>
+
+#include "recording.h"
+#include "bitmaps.h"
+#include "palettes.h"
+
+// Headless builds map files the POSIX way; everything else is Windows.
+#ifdef YOK_HEADLESS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::get;
+
+size_t Recording::frame_size(size_t sprite_count) {
+	size_t textures_size = (sprite_count * sizeof(uint16_t) + 3) & ~(size_t) 3;
+	return sizeof(RecordedFrame) + sprite_count * 2 * sizeof(float) + textures_size;
+}
+
+Recording::RecordedTexture Recording::describe(const Texture *texture) {
+	RecordedTexture recorded{};
+
+	const PaletteData &palette = texture->palette();
+	for (size_t c = 0; c < _PALETTE_SIZE; c++) {
+		recorded.colors[c][RED] = get<RED>(palette[c]);
+		recorded.colors[c][GREEN] = get<GREEN>(palette[c]);
+		recorded.colors[c][BLUE] = get<BLUE>(palette[c]);
+		recorded.colors[c][ALPHA] = get<ALPHA>(palette[c]);
+	}
+
+	recorded.bitmap_resource_id = Bitmaps::Lk.resource_id;
+	for (const auto &bitmap : Bitmaps::All) {
+		if (bitmap.data == &texture->bitmap()) {
+			recorded.bitmap_resource_id = bitmap.resource_id;
+		}
+	}
+
+	return recorded;
+}
+
+const Texture *Recording::texture(const RecordedTexture &recorded, PaletteCache &palettes) {
+	std::array<Color, _PALETTE_SIZE> colors;
+	for (size_t c = 0; c < _PALETTE_SIZE; c++) {
+		colors[c] = Color(recorded.colors[c][RED], recorded.colors[c][GREEN], recorded.colors[c][BLUE], recorded.colors[c][ALPHA]);
+	}
+
+	const PaletteData *&palette = palettes[colors];
+	if (palette == nullptr) {
+		palette = new PaletteData(colors);
+	}
+
+	const BitmapData *bitmap = Bitmaps::Lk.data;
+	for (const auto &definition : Bitmaps::All) {
+		if (definition.resource_id == recorded.bitmap_resource_id) {
+			bitmap = definition.data;
+		}
+	}
+
+	return Texture::get(*palette, *bitmap);
+}
+
+Recorder::Recorder(const std::filesystem::path &path, const Sprites &sprites, Context &ctx)
+	: m_file(path, std::ios::binary | std::ios::trunc), m_header{}
+{
+	std::memcpy(m_header.magic, Recording::MAGIC, sizeof(m_header.magic));
+	m_header.version = Recording::VERSION;
+	m_header.sprite_count = cast<uint32_t>(sprites.size());
+	m_header.width = cast<int32_t>(ctx.rect().right);
+	m_header.height = cast<int32_t>(ctx.rect().bottom);
+
+	// The counts aren't known yet; they're filled in at the end.
+	m_file.write((const char *) &m_header, sizeof(m_header));
+
+	for (size_t i = 0; i < sprites.size(); i++) {
+		Recording::RecordedSprite sprite = { cast<float>(sprites.size(i)), cast<uint32_t>(sprites.kind(i)) };
+		m_file.write((const char *) &sprite, sizeof(sprite));
+	}
+
+	m_frame.resize(Recording::frame_size(sprites.size()));
+}
+
+Recorder::~Recorder() {
+	if (!ok()) {
+		return;
+	}
+
+	m_header.texture_count = cast<uint32_t>(m_textures.size());
+	m_header.texture_table_offset = cast<uint64_t>(m_file.tellp());
+	m_file.write((const char *) m_textures.data(), m_textures.size() * sizeof(Recording::RecordedTexture));
+
+	m_file.seekp(0);
+	m_file.write((const char *) &m_header, sizeof(m_header));
+}
+
+bool Recorder::ok() const {
+	return m_file.good();
+}
+
+void Recorder::record(const Sprites &sprites, unsigned int frame_count, PatternName pattern) {
+	if (!ok() || sprites.size() != m_header.sprite_count) {
+		return;
+	}
+
+	size_t n = sprites.size();
+	unsigned char *at = m_frame.data();
+
+	Recording::RecordedFrame frame = { frame_count, cast<uint32_t>(pattern) };
+	std::memcpy(at, &frame, sizeof(frame));
+	at += sizeof(frame);
+
+	for (size_t i = 0; i < n; i++) {
+		float x = cast<float>(sprites.final<X>(i));
+		std::memcpy(at + i * sizeof(float), &x, sizeof(float));
+	}
+	at += n * sizeof(float);
+
+	for (size_t i = 0; i < n; i++) {
+		float y = cast<float>(sprites.final<Y>(i));
+		std::memcpy(at + i * sizeof(float), &y, sizeof(float));
+	}
+	at += n * sizeof(float);
+
+	for (size_t i = 0; i < n; i++) {
+		uint16_t texture = texture_index(sprites.texture(i));
+		std::memcpy(at + i * sizeof(uint16_t), &texture, sizeof(uint16_t));
+	}
+
+	m_file.write((const char *) m_frame.data(), m_frame.size());
+	m_header.frame_count++;
+}
+
+uint16_t Recorder::texture_index(const Texture *texture) {
+	auto known = m_texture_indices.find(texture);
+	if (known != m_texture_indices.end()) {
+		return known->second;
+	}
+
+	// There are only ever as many textures as palettes times bitmaps, which is
+	// nowhere near this; but should it ever be, they'll have to make do.
+	if (m_textures.size() > UINT16_MAX) {
+		return 0;
+	}
+
+	uint16_t index = cast<uint16_t>(m_textures.size());
+	m_textures.push_back(Recording::describe(texture));
+	m_texture_indices.emplace(texture, index);
+
+	return index;
+}
+
+#ifndef YOK_HEADLESS
+MappedFile::MappedFile(const std::filesystem::path &path)
+	: m_data(nullptr), m_size(0)
+{
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	// The view keeps the mapping open, and the mapping the file; so neither handle is needed after.
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			m_data = (const unsigned char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (m_data != nullptr) {
+				m_size = cast<size_t>(size.QuadPart);
+			}
+
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+	}
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path &path)
+	: m_data(nullptr), m_size(0)
+{
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		void *data = mmap(nullptr, cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			// It gets read front to back, so the kernel may as well read ahead.
+			madvise(data, cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+			m_data = (const unsigned char *) data;
+			m_size = cast<size_t>(status.st_size);
+		}
+	}
+
+	::close(file);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		munmap((void *) m_data, m_size);
+	}
+}
+#endif
+
+const unsigned char *MappedFile::data() const {
+	return m_data;
+}
+
+size_t MappedFile::size() const {
+	return m_size;
+}
+
+std::unique_ptr<Playback> Playback::open(const std::filesystem::path &path) {
+	auto file = std::make_unique<MappedFile>(path);
+	if (file->data() == nullptr) {
+		return nullptr;
+	}
+
+	std::unique_ptr<Playback> playback(new Playback(std::move(file)));
+	if (!playback->load()) {
+		return nullptr;
+	}
+
+	return playback;
+}
+
+Playback::Playback(std::unique_ptr<MappedFile> file)
+	: m_file(std::move(file)), m_header{}, m_next_frame(0), m_pattern(Roamers) { }
+
+bool Playback::load() {
+	size_t size = m_file->size();
+	if (size < sizeof(m_header)) {
+		return false;
+	}
+
+	std::memcpy(&m_header, m_file->data(), sizeof(m_header));
+
+	if (std::memcmp(m_header.magic, Recording::MAGIC, sizeof(m_header.magic)) != 0 || m_header.version != Recording::VERSION) {
+		return false;
+	}
+
+	// A recording that was never finished has nothing in its header to go on.
+	if (m_header.sprite_count == 0 || m_header.frame_count == 0 || m_header.texture_count == 0) {
+		return false;
+	}
+
+	// Every frame and texture has to be where the header says, and all within the file.
+	size_t frames_start = sizeof(m_header) + m_header.sprite_count * sizeof(Recording::RecordedSprite);
+	size_t frames_end = m_header.texture_table_offset;
+	if (frames_end < frames_start || frames_end > size
+		|| (frames_end - frames_start) / Recording::frame_size(m_header.sprite_count) < m_header.frame_count
+		|| (size - frames_end) / sizeof(Recording::RecordedTexture) < m_header.texture_count) {
+		return false;
+	}
+
+	Recording::PaletteCache palettes;
+	for (size_t t = 0; t < m_header.texture_count; t++) {
+		Recording::RecordedTexture recorded;
+		std::memcpy(&recorded, m_file->data() + frames_end + t * sizeof(recorded), sizeof(recorded));
+		m_textures.push_back(Recording::texture(recorded, palettes));
+	}
+
+	return true;
+}
+
+const unsigned char *Playback::frame(size_t f) const {
+	size_t frames_start = sizeof(m_header) + m_header.sprite_count * sizeof(Recording::RecordedSprite);
+	return m_file->data() + frames_start + f * Recording::frame_size(m_header.sprite_count);
+}
+
+Sprites Playback::make() const {
+	size_t n = m_header.sprite_count;
+	const unsigned char *sprite_table = m_file->data() + sizeof(m_header);
+	const unsigned char *first = frame(0) + sizeof(Recording::RecordedFrame);
+
+	Sprites sprites;
+	for (size_t i = 0; i < n; i++) {
+		Recording::RecordedSprite recorded;
+		std::memcpy(&recorded, sprite_table + i * sizeof(recorded), sizeof(recorded));
+
+		float x, y;
+		uint16_t texture;
+		std::memcpy(&x, first + i * sizeof(float), sizeof(float));
+		std::memcpy(&y, first + (n + i) * sizeof(float), sizeof(float));
+		std::memcpy(&texture, first + n * 2 * sizeof(float) + i * sizeof(uint16_t), sizeof(uint16_t));
+
+		SpriteStore::Kind kind = recorded.kind == SpriteStore::YONKER ? SpriteStore::YONKER : SpriteStore::IMPOSTOR;
+		size_t added = sprites.add(kind, m_textures[texture < m_textures.size() ? texture : 0], Point(x, y));
+		sprites.m_sizes[added] = cast<Real>(recorded.size);
+	}
+
+	return sprites;
+}
+
+void Playback::play(Sprites &sprites, Context &ctx) {
+	size_t n = m_header.sprite_count;
+	const unsigned char *at = frame(m_next_frame);
+
+	Recording::RecordedFrame recorded;
+	std::memcpy(&recorded, at, sizeof(recorded));
+	at += sizeof(recorded);
+
+	const unsigned char *xs = at;
+	const unsigned char *ys = xs + n * sizeof(float);
+	const unsigned char *textures = ys + n * sizeof(float);
+
+	for (size_t i = 0; i < (std::min)(n, sprites.size()); i++) {
+		float x, y;
+		uint16_t texture;
+		std::memcpy(&x, xs + i * sizeof(float), sizeof(float));
+		std::memcpy(&y, ys + i * sizeof(float), sizeof(float));
+		std::memcpy(&texture, textures + i * sizeof(uint16_t), sizeof(uint16_t));
+
+		sprites.m_home[X][i] = cast<Real>(x);
+		sprites.m_home[Y][i] = cast<Real>(y);
+		sprites.m_relpos[X][i] = Real(0);
+		sprites.m_relpos[Y][i] = Real(0);
+		sprites.m_textures[i] = m_textures[texture < m_textures.size() ? texture : 0];
+	}
+
+	if (sprites.advance_trails()) {
+		sprites.update_trails(0, sprites.size());
+	}
+
+	ctx.frame_count() = recorded.frame_count;
+	m_pattern = recorded.pattern < _PATTERN_COUNT ? (PatternName) recorded.pattern : Roamers;
+	m_next_frame = (m_next_frame + 1) % m_header.frame_count;
+}
+
+size_t Playback::frame_count() const {
+	return m_header.frame_count;
+}
+
+PatternName Playback::pattern() const {
+	return m_pattern;
+}
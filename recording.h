@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "context.h"
+#include "graphics.h"
+#include "sprite.h"
+#include "spritecontrol.h"
+
+// A recording is everything that was on screen, one simulation step at a time,
+// so it can be played back later without simulating anything at all.
+//
+// It's laid out so playback can map the file and read frames straight out of it:
+//
+//     RecordingHeader
+//     RecordedSprite      × sprite_count, in store order (Yonkers first)
+//     frame               × frame_count, each frame_size(sprite_count) bytes:
+//         RecordedFrame
+//         float x         × sprite_count
+//         float y         × sprite_count
+//         uint16_t texture × sprite_count, padded out to 4 bytes
+//     RecordedTexture     × texture_count
+//
+// Everything is little-endian. The textures go last since new ones turn up as the
+// Yonkers change their faces; the header only gets its counts once the recording's done.
+struct Recording {
+	constexpr static char MAGIC[8] = { 'Y', 'O', 'K', 'R', 'E', 'C', 0, 0 };
+	constexpr static uint32_t VERSION = 1;
+
+	struct RecordingHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t sprite_count;
+		uint32_t frame_count;
+		uint32_t texture_count;
+		uint64_t texture_table_offset;
+		int32_t width;
+		int32_t height;
+	};
+
+	struct RecordedSprite {
+		float size;
+		uint32_t kind;
+	};
+
+	struct RecordedFrame {
+		uint32_t frame_count;
+		uint32_t pattern;
+	};
+
+	// A palette and a bitmap, which together make a texture.
+	struct RecordedTexture {
+		uint8_t colors[_PALETTE_SIZE][4];
+		int32_t bitmap_resource_id;
+	};
+
+	// Palettes made while rebuilding textures, by their colours, so each is only made once.
+	using PaletteCache = std::map<std::array<Color, _PALETTE_SIZE>, const PaletteData *>;
+
+	static size_t frame_size(size_t sprite_count);
+
+	// A texture as something that still means the same thing in another process.
+	static RecordedTexture describe(const Texture *texture);
+	// And back again. The palettes it makes are kept forever, like the textures made from them.
+	static const Texture *texture(const RecordedTexture &recorded, PaletteCache &palettes);
+};
+
+static_assert(sizeof(Recording::RecordingHeader) == 40);
+static_assert(sizeof(Recording::RecordedSprite) == 8);
+static_assert(sizeof(Recording::RecordedFrame) == 8);
+static_assert(sizeof(Recording::RecordedTexture) == 36);
+
+// Writes every step it's given to a recording. It's only finished, and fit to
+// play back, once it's been destroyed.
+class Recorder {
+public:
+	Recorder(const std::filesystem::path &path, const Sprites &sprites, Context &ctx);
+	~Recorder();
+
+	Recorder(const Recorder &recorder) = delete;
+	Recorder &operator=(const Recorder &recorder) = delete;
+
+	// Whether the file could be written to at all.
+	bool ok() const;
+
+	// Call it after each step, once everyone's where they're going to be drawn.
+	void record(const Sprites &sprites, unsigned int frame_count, PatternName pattern);
+
+private:
+	uint16_t texture_index(const Texture *texture);
+
+	std::ofstream m_file;
+	Recording::RecordingHeader m_header;
+	std::vector<unsigned char> m_frame;
+	std::map<const Texture *, uint16_t> m_texture_indices;
+	std::vector<Recording::RecordedTexture> m_textures;
+};
+
+// A whole file, mapped read-only. Only as many pages get read as get looked at.
+class MappedFile {
+public:
+	MappedFile(const std::filesystem::path &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &file) = delete;
+	MappedFile &operator=(const MappedFile &file) = delete;
+
+	// Null if the file couldn't be mapped.
+	const unsigned char *data() const;
+	size_t size() const;
+
+private:
+	const unsigned char *m_data;
+	size_t m_size;
+};
+
+// Plays a recording back over and over, one recorded step per step.
+class Playback {
+public:
+	// Null if there's no recording there, or it isn't one we can read.
+	static std::unique_ptr<Playback> open(const std::filesystem::path &path);
+
+	Playback(const Playback &playback) = delete;
+	Playback &operator=(const Playback &playback) = delete;
+
+	// Everyone in the recording, where the first frame has them.
+	Sprites make() const;
+
+	// Puts everyone where the next recorded frame has them, with the face it had,
+	// and leaves a trail behind like a real step would. Back to the start after the last.
+	void play(Sprites &sprites, Context &ctx);
+
+	size_t frame_count() const;
+	PatternName pattern() const;
+
+private:
+	Playback(std::unique_ptr<MappedFile> file);
+
+	bool load();
+	const unsigned char *frame(size_t f) const;
+
+	std::unique_ptr<MappedFile> m_file;
+	Recording::RecordingHeader m_header;
+	std::vector<const Texture *> m_textures;
+	size_t m_next_frame;
+	PatternName m_pattern;
+};
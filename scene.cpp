@@ -2,15 +2,76 @@
 #include "bitmaps.h"
 #include "config.h"
 #include "spritecontrol.h"
+#include "snapshot.h"
+
+// Neither of these has a place in the config dialog; they're for chasing down what
+// someone saw, so they go straight into the registry as paths. Empty means off.
+static const std::wstring RECORD_TO = L"RecordTo";
+static const std::wstring REPLAY_FROM = L"ReplayFrom";
+// Where to keep the session between runs, so the next one picks up where this one stopped.
+static const std::wstring SESSION_FILE = L"SessionFile";
 
 Scene::Scene(HWND window)
 // It's of utmost importance the context comes first!
 // Else reality cursed, at the seams it will burst!!!
 	: m_ctx(window),
-	  m_sprites(SpriteGenerator().make(cast<unsigned int>(cfg[Cfg::SpriteCount]))),
-	  m_choreographer((PatternName) cfg[Cfg::Pattern], &m_sprites, &m_ctx) { }
+	  m_simulation(&m_ctx, open_replay()),
+	  m_background_rgba(nullptr),
+	  m_background_tex_id(0),
+	  m_last_tick(std::chrono::steady_clock::now()),
+	  m_lag(0.0),
+	  m_blend(1.0f)
+{
+	Registry registry;
+
+	std::wstring session_file = registry.get_string(SESSION_FILE, L"");
+	if (!session_file.empty()) {
+		restore(Snapshot::read_file(session_file));
+	}
+
+	std::wstring record_to = registry.get_string(RECORD_TO, L"");
+	if (!record_to.empty()) {
+		m_simulation.record(record_to);
+	}
+}
+
+Scene::~Scene() {
+	std::wstring session_file = Registry().get_string(SESSION_FILE, L"");
+	if (!session_file.empty() && m_simulation.playback() == nullptr) {
+		Snapshot::write_file(session_file, snapshot());
+	}
+
+	delete[] m_background_rgba;
+}
+
+std::vector<unsigned char> Scene::snapshot() const {
+	return m_simulation.snapshot();
+}
+
+// Whatever was on screen a moment ago is gone, so there's nothing to blend from.
+bool Scene::restore(const std::vector<unsigned char> &blob) {
+	if (!m_simulation.restore(blob)) {
+		return false;
+	}
+
+	m_last_tick = std::chrono::steady_clock::now();
+	m_lag = 0.0;
+	m_blend = Real(1);
+	return true;
+}
+
+// A recording that can't be played just means simulating like usual.
+std::unique_ptr<Playback> Scene::open_replay() {
+	std::wstring replay_from = Registry().get_string(REPLAY_FROM, L"");
+	return replay_from.empty() ? nullptr : Playback::open(replay_from);
+}
+
+bool Scene::vsync() {
+	return m_ctx.vsync();
+}
 
 void Scene::draw() {
+	m_ctx.make_current();
 	glViewport(0, 0, m_ctx.rect().right, m_ctx.rect().bottom);
 	gluPerspective(45, 1.0 * m_ctx.rect().right / m_ctx.rect().bottom, 1.0, 1000);
 	glMatrixMode(GL_MODELVIEW);
@@ -22,37 +83,66 @@ void Scene::draw() {
 		draw_background();
 	}
 
-	m_choreographer.update();
+	advance();
 
-	for (Sprite *sprite : m_sprites) {
-		sprite->draw(m_ctx);
+	// Drawn here rather than while Bubbles steps, so they're there once every frame,
+	// played back or not, and right where the bubbles are drawn.
+	if (m_simulation.pattern() == Bubbles) {
+		m_simulation.sprites().draw_outlines(bubble_radii(&m_ctx), m_blend);
 	}
 
+	m_simulation.sprites().draw(m_ctx, m_blend);
+
 	glFlush();
 	SwapBuffers(m_ctx.device());
-
-	m_ctx.frame_count()++;
 }
 
-GLuint Scene::background_tex_id = 0;
+// The clock on the wall says how many steps are due;
+// Each one the same length, be the screen slow or new.
+// Fall too far behind and the rest are let go;
+// The Yonkers just pause, they don't run to and fro.
+void Scene::advance() {
+	using namespace std::chrono;
+
+	steady_clock::time_point now = steady_clock::now();
+	m_lag += duration<double>(now - m_last_tick).count();
+	m_last_tick = now;
+
+	double step_length = 1.0 / std::clamp(cfg[Cfg::StepRate], Cfg::StepRate.range.first, Cfg::StepRate.range.second);
+
+	for (int steps = 0; m_lag >= step_length && steps < MAX_CATCH_UP_STEPS; steps++) {
+		m_simulation.step();
+		m_lag -= step_length;
+	}
+
+	if (m_lag >= step_length) {
+		m_lag = std::fmod(m_lag, step_length);
+	}
+
+	m_blend = cast<Real>(m_lag / step_length);
+}
 
 void Scene::draw_background() {
-	static BYTE *background_rgba = get_background_rgba();
+	m_ctx.make_current();
+
+	if (m_background_rgba == nullptr) {
+		m_background_rgba = get_background_rgba();
+	}
 
 	// The MSDN OpenGL docs don't really say if 0 is a valid texture id,
 	// so... I'm just gonna hope it isn't.
-	if (background_tex_id == 0) {
-		glGenTextures(1, &background_tex_id);
+	if (m_background_tex_id == 0) {
+		glGenTextures(1, &m_background_tex_id);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, background_tex_id);
+	glBindTexture(GL_TEXTURE_2D, m_background_tex_id);
 
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_ctx.rect().right, m_ctx.rect().bottom, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, background_rgba);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_ctx.rect().right, m_ctx.rect().bottom, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, m_background_rgba);
 
 	glBegin(GL_QUADS);
 
@@ -1,25 +1,44 @@
 #pragma once
 
 #include <vector>
+#include <chrono>
+#include <memory>
 
 #include "context.h"
-#include "sprite.h"
-#include "spritecontrol.h"
+#include "simulation.h"
 #include "common.h"
 
 class Scene {
 public:
 	Scene(HWND window);
+	~Scene();
 
 	void draw();
+	// See Context::vsync.
+	bool vsync();
 	void draw_background();
 
+	// See Simulation::snapshot and Simulation::restore.
+	std::vector<unsigned char> snapshot() const;
+	bool restore(const std::vector<unsigned char> &blob);
+
 private:
+	// Falling further behind than this many steps, the rest are let go.
+	constexpr static int MAX_CATCH_UP_STEPS = 8;
+
+	void advance();
 	BYTE *get_background_rgba();
 
-	static GLuint background_tex_id;
+	static std::unique_ptr<Playback> open_replay();
 
 	Context m_ctx;
-	Sprites m_sprites;
-	SpriteChoreographer m_choreographer;
+	Simulation m_simulation;
+
+	// What was on screen before we were, taken the first time it's drawn.
+	BYTE *m_background_rgba;
+	GLuint m_background_tex_id;
+
+	std::chrono::steady_clock::time_point m_last_tick;
+	double m_lag;
+	Real m_blend;
 };
\ No newline at end of file
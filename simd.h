@@ -0,0 +1,56 @@
+#pragma once
+
+// What the SIMD kernels need to pick themselves at startup: which instructions
+// this build can emit, and which of them this CPU can run.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define YOK_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define YOK_TARGET(isa)
+#else
+#define YOK_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum class SimdLevel {
+	Scalar,
+	SSE41,
+	AVX2,
+};
+
+inline SimdLevel simd_level() {
+#ifdef YOK_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	bool has_sse41 = info[2] & (1 << 19);
+	bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+
+	bool has_avx2 = false;
+	if (has_avx && max_leaf >= 7) {
+		__cpuidex(info, 7, 0);
+		has_avx2 = info[1] & (1 << 5);
+	}
+#else
+	__builtin_cpu_init();
+	bool has_sse41 = __builtin_cpu_supports("sse4.1");
+	bool has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (has_avx2) {
+		return SimdLevel::AVX2;
+	}
+
+	if (has_sse41) {
+		return SimdLevel::SSE41;
+	}
+#endif
+
+	return SimdLevel::Scalar;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+
+#include "simulation.h"
+#include "config.h"
+#include "noise.h"
+#include "snapshot.h"
+
+// However many threads the registry asks for, within reason; anything that isn't a
+// number at all gets the default.
+static unsigned int update_threads() {
+	double threads = cfg[Cfg::UpdateThreads];
+	if (std::isnan(threads)) {
+		threads = Cfg::UpdateThreads.default_;
+	}
+
+	return cast<unsigned int>(std::clamp(threads, Cfg::UpdateThreads.range.first, Cfg::UpdateThreads.range.second));
+}
+
+Simulation::Simulation(Context *ctx, std::unique_ptr<Playback> playback)
+	: m_ctx(ctx),
+	  m_playback(std::move(playback)),
+	  m_sprites(m_playback ? m_playback->make() : SpriteGenerator(ctx).make(cast<unsigned int>(cfg[Cfg::SpriteCount]))),
+	  m_workers(update_threads()),
+	  m_choreographer((PatternName) cfg[Cfg::Pattern], &m_sprites, ctx, &m_workers) { }
+
+void Simulation::step() {
+	m_sprites.remember_positions();
+
+	if (m_playback) {
+		StageClock::Scope timing(m_ctx->stages(), Stage::Playback);
+		m_playback->play(m_sprites, *m_ctx);
+		return;
+	}
+
+	m_choreographer.update();
+	m_ctx->frame_count()++;
+
+	if (m_recorder) {
+		StageClock::Scope timing(m_ctx->stages(), Stage::Recording);
+		m_recorder->record(m_sprites, m_ctx->frame_count(), m_choreographer.pattern());
+	}
+}
+
+bool Simulation::record(const std::filesystem::path &path) {
+	m_recorder = std::make_unique<Recorder>(path, m_sprites, *m_ctx);
+	if (!m_recorder->ok()) {
+		m_recorder.reset();
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<unsigned char> Simulation::snapshot() const {
+	if (m_playback) {
+		return {};
+	}
+
+	SnapshotWriter snapshot;
+	snapshot.put<uint32_t>(m_ctx->frame_count());
+	snapshot.put<uint64_t>(m_ctx->streams().session_seed());
+	for (size_t s = 0; s < (size_t) RandomStream::_STREAM_COUNT; s++) {
+		snapshot.put(m_ctx->rng((RandomStream) s).state());
+	}
+
+	m_sprites.save(snapshot);
+	m_choreographer.save(snapshot);
+
+	return snapshot.finish();
+}
+
+bool Simulation::restore(const std::vector<unsigned char> &blob) {
+	if (m_playback) {
+		return false;
+	}
+
+	SnapshotReader snapshot(blob);
+
+	uint32_t frame_count = 0;
+	uint64_t seed = 0;
+	std::array<Random::State, (size_t) RandomStream::_STREAM_COUNT> streams = {};
+	snapshot.get(frame_count);
+	snapshot.get(seed);
+	for (Random::State &stream : streams) {
+		snapshot.get(stream);
+	}
+
+	// Everything's read and checked, right to the end, before any of it's taken in; so a
+	// snapshot that's bad anywhere leaves the simulation just as it was.
+	Sprites sprites;
+	SpriteChoreographer::Saved choreography;
+	if (!snapshot.ok() || !sprites.load(snapshot) || !m_choreographer.read(snapshot, sprites.size(), choreography) || !snapshot.done()) {
+		return false;
+	}
+
+	m_sprites = std::move(sprites);
+	m_choreographer.apply(std::move(choreography));
+	m_ctx->frame_count() = frame_count;
+
+	m_ctx->streams().seed(seed);
+	for (size_t s = 0; s < (size_t) RandomStream::_STREAM_COUNT; s++) {
+		m_ctx->rng((RandomStream) s).set_state(streams[s]);
+	}
+
+	return true;
+}
+
+Sprites &Simulation::sprites() {
+	return m_sprites;
+}
+
+PatternName Simulation::pattern() const {
+	return m_playback ? m_playback->pattern() : m_choreographer.pattern();
+}
+
+const Playback *Simulation::playback() const {
+	return m_playback.get();
+}
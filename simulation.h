@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "context.h"
+#include "recording.h"
+#include "sprite.h"
+#include "spritecontrol.h"
+#include "workers.h"
+
+// Everything that moves, and nothing that draws: the sprites, whoever's
+// choreographing them, and the workers that help out. It goes one fixed step
+// at a time; how often is up to whoever's driving, be it a Scene or a bench.
+class Simulation {
+public:
+	// Makes the sprites from whatever cfg says, so set that up first.
+	// Given a playback, it doesn't simulate anything; each step is just the next one from the recording.
+	Simulation(Context *ctx, std::unique_ptr<Playback> playback = nullptr);
+
+	Simulation(const Simulation &simulation) = delete;
+	Simulation &operator=(const Simulation &simulation) = delete;
+
+	void step();
+
+	// Writes every step from here on to path. False if it can't be written.
+	bool record(const std::filesystem::path &path);
+
+	// Everything needed to carry on from exactly this step, randomness and all.
+	// There's nothing to keep while playing a recording back, so that's empty.
+	std::vector<unsigned char> snapshot() const;
+	// Carries on from a snapshot. False if it isn't one this build can use, or cfg has
+	// changed how long the trails are since; either way that's found out before anything's touched.
+	bool restore(const std::vector<unsigned char> &blob);
+
+	Sprites &sprites();
+	PatternName pattern() const;
+	// Null unless this is playing a recording back.
+	const Playback *playback() const;
+
+private:
+	Context *m_ctx;
+	std::unique_ptr<Playback> m_playback;
+	Sprites m_sprites;
+	WorkerPool m_workers;
+	SpriteChoreographer m_choreographer;
+	std::unique_ptr<Recorder> m_recorder;
+};
@@ -0,0 +1,134 @@
+#include <fstream>
+#include <iterator>
+
+#include "snapshot.h"
+
+static uint64_t fnv1a(const unsigned char *data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+bool Snapshot::write_file(const std::filesystem::path &path, const std::vector<unsigned char> &blob) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write((const char *) blob.data(), blob.size());
+	return file.good();
+}
+
+std::vector<unsigned char> Snapshot::read_file(const std::filesystem::path &path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return {};
+	}
+
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void SnapshotWriter::put_texture(const Texture *texture) {
+	auto known = m_texture_indices.find(texture);
+	if (known != m_texture_indices.end()) {
+		put(known->second);
+		return;
+	}
+
+	uint32_t index = cast<uint32_t>(m_textures.size());
+	m_textures.push_back(Recording::describe(texture));
+	m_texture_indices.emplace(texture, index);
+	put(index);
+}
+
+std::vector<unsigned char> SnapshotWriter::finish() const {
+	Snapshot::SnapshotHeader header{};
+	std::memcpy(header.magic, Snapshot::MAGIC, sizeof(header.magic));
+	header.version = Snapshot::VERSION;
+	header.real_size = sizeof(Real);
+	header.texture_count = cast<uint32_t>(m_textures.size());
+	header.body_size = m_body.size();
+	header.body_hash = fnv1a(m_body.data(), m_body.size());
+
+	size_t textures_size = m_textures.size() * sizeof(Recording::RecordedTexture);
+
+	std::vector<unsigned char> blob(sizeof(header) + textures_size + m_body.size());
+	std::memcpy(blob.data(), &header, sizeof(header));
+	if (textures_size > 0) {
+		std::memcpy(blob.data() + sizeof(header), m_textures.data(), textures_size);
+	}
+	if (!m_body.empty()) {
+		std::memcpy(blob.data() + sizeof(header) + textures_size, m_body.data(), m_body.size());
+	}
+
+	return blob;
+}
+
+SnapshotReader::SnapshotReader(const std::vector<unsigned char> &blob)
+	: m_ok(false), m_body(nullptr), m_body_size(0), m_at(0)
+{
+	Snapshot::SnapshotHeader header;
+	if (blob.size() < sizeof(header)) {
+		return;
+	}
+
+	std::memcpy(&header, blob.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, Snapshot::MAGIC, sizeof(header.magic)) != 0
+		|| header.version != Snapshot::VERSION || header.real_size != sizeof(Real)) {
+		return;
+	}
+
+	size_t rest = blob.size() - sizeof(header);
+	if (rest / sizeof(Recording::RecordedTexture) < header.texture_count) {
+		return;
+	}
+
+	size_t textures_size = header.texture_count * sizeof(Recording::RecordedTexture);
+	if (rest - textures_size != header.body_size) {
+		return;
+	}
+
+	m_body = blob.data() + sizeof(header) + textures_size;
+	m_body_size = cast<size_t>(header.body_size);
+	if (fnv1a(m_body, m_body_size) != header.body_hash) {
+		return;
+	}
+
+	Recording::PaletteCache palettes;
+	for (size_t t = 0; t < header.texture_count; t++) {
+		Recording::RecordedTexture recorded;
+		std::memcpy(&recorded, blob.data() + sizeof(header) + t * sizeof(recorded), sizeof(recorded));
+		m_textures.push_back(Recording::texture(recorded, palettes));
+	}
+
+	m_ok = true;
+}
+
+bool SnapshotReader::ok() const {
+	return m_ok;
+}
+
+bool SnapshotReader::done() const {
+	return m_ok && m_at == m_body_size;
+}
+
+bool SnapshotReader::get_texture(const Texture *&texture) {
+	uint32_t index;
+	if (!get(index) || index >= m_textures.size()) {
+		m_ok = false;
+		return false;
+	}
+
+	texture = m_textures[index];
+	return true;
+}
+
+bool SnapshotReader::take(size_t size) {
+	if (!m_ok || size > m_body_size - m_at) {
+		m_ok = false;
+		return false;
+	}
+
+	m_at += size;
+	return true;
+}
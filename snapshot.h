@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+#include "graphics.h"
+#include "recording.h"
+
+// Everything a simulation needs to carry on exactly where it left off, as one blob:
+//
+//     SnapshotHeader
+//     RecordedTexture  × texture_count
+//     the body, whatever each part wrote, in the order it wrote it
+//
+// Textures are written as indices into the table, so they survive a trip to another process.
+// Like recordings, it's little-endian, and only ever read back by the same version that wrote it.
+struct Snapshot {
+	constexpr static char MAGIC[8] = { 'Y', 'O', 'K', 'S', 'N', 'A', 'P', 0 };
+	constexpr static uint32_t VERSION = 3;
+
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		// Positions are written as they are, so whoever reads them has to count in the same thing.
+		uint32_t real_size;
+		uint32_t texture_count;
+		uint32_t reserved;
+		uint64_t body_size;
+		// FNV-1a over the body, so a damaged one is refused before anything is touched.
+		uint64_t body_hash;
+	};
+
+	static bool write_file(const std::filesystem::path &path, const std::vector<unsigned char> &blob);
+	// Empty if there's nothing there.
+	static std::vector<unsigned char> read_file(const std::filesystem::path &path);
+};
+
+static_assert(sizeof(Snapshot::SnapshotHeader) == 40);
+
+class SnapshotWriter {
+public:
+	template <typename T> void put(const T &value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		size_t at = m_body.size();
+		m_body.resize(at + sizeof(T));
+		std::memcpy(m_body.data() + at, &value, sizeof(T));
+	}
+
+	template <typename T> void put(const std::vector<T> &values) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		put<uint64_t>(values.size());
+		size_t at = m_body.size();
+		m_body.resize(at + values.size() * sizeof(T));
+		if (!values.empty()) {
+			std::memcpy(m_body.data() + at, values.data(), values.size() * sizeof(T));
+		}
+	}
+
+	void put_texture(const Texture *texture);
+
+	// The header, the textures, and everything put so far.
+	std::vector<unsigned char> finish() const;
+
+private:
+	std::vector<unsigned char> m_body;
+	std::map<const Texture *, uint32_t> m_texture_indices;
+	std::vector<Recording::RecordedTexture> m_textures;
+};
+
+// Reads a snapshot back in the order it was written. Once anything's
+// gone wrong, every get() after it fails too, so it's enough to check at the end.
+class SnapshotReader {
+public:
+	SnapshotReader(const std::vector<unsigned char> &blob);
+
+	// Whether everything so far made sense.
+	bool ok() const;
+	// Whether everything made sense and all of it was read.
+	bool done() const;
+
+	template <typename T> bool get(T &value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		if (!take(sizeof(T))) {
+			return false;
+		}
+
+		std::memcpy(&value, m_body + m_at - sizeof(T), sizeof(T));
+		return true;
+	}
+
+	template <typename T> bool get(std::vector<T> &values) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		uint64_t count;
+		if (!get(count) || count > (m_body_size - m_at) / sizeof(T) || !take(count * sizeof(T))) {
+			m_ok = false;
+			return false;
+		}
+
+		values.resize(count);
+		if (count > 0) {
+			std::memcpy(values.data(), m_body + m_at - count * sizeof(T), count * sizeof(T));
+		}
+		return true;
+	}
+
+	bool get_texture(const Texture *&texture);
+
+private:
+	bool take(size_t size);
+
+	bool m_ok;
+	const unsigned char *m_body;
+	size_t m_body_size;
+	size_t m_at;
+	std::vector<const Texture *> m_textures;
+};
@@ -1,55 +1,271 @@
 #include <algorithm>
+#include <cmath>
 
 #include "sprite.h"
 #include "noise.h"
 #include "bitmaps.h"
 #include "config.h"
 #include "common.h"
+#include "snapshot.h"
 
 using std::get;
 
-Sprite::Sprite(const Texture *texture, const Point &home, const bool has_trail)
-	: m_texture(texture), m_home(home), m_relpos(0.0, 0.0), m_size(cfg[Cfg::SpriteSize] / 1000.0f), m_trail_start_index(0)
-{
-	if (has_trail) {
-		for (int i = 0; i < TrailSprite::get_trail_length(); i++) {
-			m_trail.emplace_back(texture, home);
-		}
+size_t SpriteStore::add(Kind kind, const Texture *texture, const Point &home) {
+	size_t i = size();
+
+	m_ids.push_back(cast<Id>(i));
+	m_kinds.push_back(kind);
+	m_home[X].push_back(get<X>(home));
+	m_home[Y].push_back(get<Y>(home));
+	m_relpos[X].push_back(0.0f);
+	m_relpos[Y].push_back(0.0f);
+	m_previous[X].push_back(get<X>(home));
+	m_previous[Y].push_back(get<Y>(home));
+	m_sizes.push_back(cast<Real>(cfg[Cfg::SpriteSize] / 1000.0));
+	m_textures.push_back(texture);
+
+	m_emotion_vector.push_back({});
+	m_emotion_sample.push_back({});
+	m_emotion_rate.push_back({});
+
+	// Until they've been anywhere, their trail's just where they started.
+	size_t trail_samples = get_trail_samples();
+	for (size_t t = 0; t < trail_samples; t++) {
+		m_trails.push_back({ home, texture });
+	}
+
+	m_kind_counts[kind]++;
+
+	return i;
+}
+
+size_t SpriteStore::size() const {
+	return m_ids.size();
+}
+
+SpriteStore::Range SpriteStore::range(Kind kind) const {
+	size_t first = 0;
+	for (int k = 0; k < kind; k++) {
+		first += m_kind_counts[k];
 	}
+
+	return { first, first + m_kind_counts[kind] };
+}
+
+Id SpriteStore::id(size_t i) const {
+	return m_ids[i];
+}
+
+SpriteStore::Kind SpriteStore::kind(size_t i) const {
+	return m_kinds[i];
+}
+
+const Texture *SpriteStore::texture(size_t i) const {
+	return m_textures[i];
 }
 
-void Sprite::change_texture(const Texture *texture) {
-	m_texture = texture;
+Real SpriteStore::size(size_t i) const {
+	return m_sizes[i];
 }
 
-void Sprite::draw(Context &ctx) {
-	draw_trail(ctx);
+SpriteStore::EmotionVector &SpriteStore::emotion(size_t i) {
+	return m_emotion_vector[i];
+}
+
+void SpriteStore::update(Context &ctx, WorkerPool &workers) {
+	bool sampling = advance_trails();
 
-	m_texture->apply();
+	Real horizontal_correction = cast<Real>((std::max)((double) ctx.rect().right / (double) ctx.rect().bottom, 1.0));
+	Real vertical_correction = cast<Real>((std::max)((double) ctx.rect().bottom / (double) ctx.rect().right, 1.0));
 
-	glColor4d(1.0, 1.0, 1.0, 1.0);
+	workers.run(size(), CHUNK, [&](size_t first, size_t last) {
+		wrap(first, last, horizontal_correction, vertical_correction);
+		update_faces(first, last);
+		if (sampling) {
+			update_trails(first, last);
+		}
+	});
+}
 
-	glPushMatrix();
-	transform();
-	glBegin(GL_QUADS);
+void SpriteStore::remember_positions() {
+	for (int c : { X, Y }) {
+		for (size_t i = 0; i < size(); i++) {
+			m_previous[c][i] = m_home[c][i] + m_relpos[c][i];
+		}
+	}
+}
 
+void SpriteStore::draw(Context &ctx, Real blend) {
 	// Reality lives in a box that is square;
 	// But plastered on a rectangular screen.
 	// Here we adjust so the ratio's fair
 	// And our wandering Llokin are properly seen.
 	double squarifiy_offset = (double) (ctx.rect().right - ctx.rect().bottom) / ctx.rect().right;
 
-	glTexCoord2d(1.0, 0.0); glVertex2d(1.0 - squarifiy_offset, -1.0);
-	glTexCoord2d(1.0, 1.0); glVertex2d(1.0 - squarifiy_offset, 1.0);
-	glTexCoord2d(0.0, 1.0); glVertex2d(-1.0 + squarifiy_offset, 1.0);
-	glTexCoord2d(0.0, 0.0); glVertex2d(-1.0 + squarifiy_offset, -1.0);
+	auto draw_one = [&](const Texture *texture, const Point &position, Real size) {
+		texture->apply(ctx);
+
+		glColor4d(1.0, 1.0, 1.0, 1.0);
+
+		glPushMatrix();
+		glTranslated(get<X>(position), get<Y>(position), 0.0);
+		glScaled(size, size, 1.0);
+		glBegin(GL_QUADS);
+
+		glTexCoord2d(1.0, 0.0); glVertex2d(1.0 - squarifiy_offset, -1.0);
+		glTexCoord2d(1.0, 1.0); glVertex2d(1.0 - squarifiy_offset, 1.0);
+		glTexCoord2d(0.0, 1.0); glVertex2d(-1.0 + squarifiy_offset, 1.0);
+		glTexCoord2d(0.0, 0.0); glVertex2d(-1.0 + squarifiy_offset, -1.0);
+
+		glEnd();
+		glPopMatrix();
+	};
+
+	size_t trail_length = get_trail_length();
+
+	// The kth point of a trail should be k * TrailSpace steps behind what's on screen, which
+	// falls somewhere between two of the samples; every point sits the same way between its two.
+	// What's on screen is itself a blend of the last two steps, hence the 1 - blend.
+	Real space = cast<Real>(get_trail_space());
+	Real trail_blend = (std::min)((space - cast<Real>(m_trail_phase) + Real(1) - blend) / space, Real(1));
+
+	for (size_t i = 0; i < size(); i++) {
+		for (size_t k = trail_length; k >= 1; k--) {
+			const TrailPoint &newer = trail(i, k - 1);
+			const TrailPoint &older = trail(i, k);
 
-	glEnd();
-	glPopMatrix();
+			const Texture *texture = trail_blend < Real(0.5) ? newer.texture : older.texture;
+			draw_one(texture, between(newer.position, older.position, trail_blend), m_sizes[i]);
+		}
+
+		Point previous = Point(m_previous[X][i], m_previous[Y][i]);
+		Point current = Point(final<X>(i), final<Y>(i));
+		draw_one(m_textures[i], between(previous, current, blend), m_sizes[i]);
+	}
+}
+
+void SpriteStore::draw_outlines(const Point &radii, Real blend) {
+	constexpr int SEGMENTS = 20;
+	const double TURN = 2 * std::acos(-1.0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glColor4d(0.2, 0.2, 0.2, 1.0);
+
+	for (size_t i = 0; i < size(); i++) {
+		Point centre = between(Point(m_previous[X][i], m_previous[Y][i]), Point(final<X>(i), final<Y>(i)), blend);
+
+		glBegin(GL_LINE_LOOP);
+		for (int k = 0; k < SEGMENTS; k++) {
+			double theta = TURN * k / SEGMENTS;
+			glVertex2d(get<X>(centre) + get<X>(radii) / 2 * std::cos(theta), get<Y>(centre) + get<Y>(radii) / 2 * std::sin(theta));
+		}
+		glEnd();
+	}
+}
+
+// Across a wrap the two are on opposite edges, and nobody should be drawn in the middle.
+Point SpriteStore::between(const Point &a, const Point &b, Real w) {
+	Real dx = get<X>(b) - get<X>(a);
+	Real dy = get<Y>(b) - get<Y>(a);
+
+	if (std::abs(dx) > Real(1) || std::abs(dy) > Real(1)) {
+		return w < Real(0.5) ? a : b;
+	}
+
+	return Point(get<X>(a) + dx * w, get<Y>(a) + dy * w);
 }
 
-void Sprite::update(Context &ctx) {
-	auto wrap = [](double home, double total, double min, double max) -> double {
+void SpriteStore::save(SnapshotWriter &snapshot) const {
+	snapshot.put<uint64_t>(get_trail_samples());
+	snapshot.put(m_ids);
+	snapshot.put(m_kinds);
+	for (int c : { X, Y }) {
+		snapshot.put(m_home[c]);
+		snapshot.put(m_relpos[c]);
+		snapshot.put(m_previous[c]);
+	}
+	snapshot.put(m_sizes);
+	for (const Texture *texture : m_textures) {
+		snapshot.put_texture(texture);
+	}
+
+	snapshot.put(m_emotion_vector);
+	snapshot.put(m_emotion_sample);
+	snapshot.put(m_emotion_rate);
+
+	for (const TrailPoint &point : m_trails) {
+		snapshot.put(get<X>(point.position));
+		snapshot.put(get<Y>(point.position));
+		snapshot.put_texture(point.texture);
+	}
+	snapshot.put<uint64_t>(m_trail_start_index);
+	snapshot.put<uint64_t>(m_trail_phase);
+	snapshot.put(m_kind_counts);
+}
+
+bool SpriteStore::load(SnapshotReader &snapshot) {
+	SpriteStore loaded;
+
+	uint64_t trail_samples;
+	if (!snapshot.get(trail_samples) || trail_samples != (uint64_t) get_trail_samples()) {
+		return false;
+	}
+
+	snapshot.get(loaded.m_ids);
+	snapshot.get(loaded.m_kinds);
+	for (int c : { X, Y }) {
+		snapshot.get(loaded.m_home[c]);
+		snapshot.get(loaded.m_relpos[c]);
+		snapshot.get(loaded.m_previous[c]);
+	}
+	snapshot.get(loaded.m_sizes);
+
+	size_t n = loaded.m_ids.size();
+	loaded.m_textures.resize(n);
+	for (size_t i = 0; i < n && snapshot.ok(); i++) {
+		snapshot.get_texture(loaded.m_textures[i]);
+	}
+
+	snapshot.get(loaded.m_emotion_vector);
+	snapshot.get(loaded.m_emotion_sample);
+	snapshot.get(loaded.m_emotion_rate);
+
+	loaded.m_trails.resize(n * trail_samples);
+	for (size_t t = 0; t < loaded.m_trails.size() && snapshot.ok(); t++) {
+		snapshot.get(get<X>(loaded.m_trails[t].position));
+		snapshot.get(get<Y>(loaded.m_trails[t].position));
+		snapshot.get_texture(loaded.m_trails[t].texture);
+	}
+
+	uint64_t trail_start_index = 0;
+	uint64_t trail_phase = 0;
+	snapshot.get(trail_start_index);
+	snapshot.get(trail_phase);
+	snapshot.get(loaded.m_kind_counts);
+	loaded.m_trail_start_index = cast<size_t>(trail_start_index);
+	loaded.m_trail_phase = cast<size_t>(trail_phase);
+
+	// Every field has to have one of everyone, or something's off.
+	bool consistent = snapshot.ok()
+		&& loaded.m_kinds.size() == n && loaded.m_sizes.size() == n
+		&& loaded.m_emotion_vector.size() == n && loaded.m_emotion_sample.size() == n && loaded.m_emotion_rate.size() == n
+		&& (trail_samples == 0 || loaded.m_trail_start_index < trail_samples)
+		&& loaded.m_trail_phase < (size_t) get_trail_space()
+		&& std::accumulate(loaded.m_kind_counts.begin(), loaded.m_kind_counts.end(), (size_t) 0) == n;
+	for (int c : { X, Y }) {
+		consistent = consistent && loaded.m_home[c].size() == n && loaded.m_relpos[c].size() == n && loaded.m_previous[c].size() == n;
+	}
+
+	if (!consistent) {
+		return false;
+	}
+
+	*this = std::move(loaded);
+	return true;
+}
+
+void SpriteStore::wrap(size_t first, size_t last, Real horizontal_correction, Real vertical_correction) {
+	auto wrap = [](Real home, Real total, Real min, Real max) -> Real {
 		if (total < min) {
 			return home + (max - min);
 		} else if (total > max) {
@@ -59,94 +275,82 @@ void Sprite::update(Context &ctx) {
 		}
 	};
 
-	double edge_boundary = 0.15 + m_size / 1.1;
-	double horizontal_correction = max((double) ctx.rect().right / (double) ctx.rect().bottom, 1.0);
-	double vertical_correction = max((double) ctx.rect().bottom / (double) ctx.rect().right, 1.0);
-	get<X>(m_home) = wrap(get<X>(m_home), final<X>(), -1.0 - (edge_boundary / horizontal_correction), 1.0 + (edge_boundary / horizontal_correction));
-	get<Y>(m_home) = wrap(get<Y>(m_home), final<Y>(), -1.0 - (edge_boundary / vertical_correction), 1.0 + (edge_boundary / vertical_correction));
+	for (size_t i = first; i < last; i++) {
+		Real edge_boundary = Real(0.15) + m_sizes[i] / Real(1.1);
+		m_home[X][i] = wrap(m_home[X][i], final<X>(i), -1.0f - (edge_boundary / horizontal_correction), 1.0f + (edge_boundary / horizontal_correction));
+		m_home[Y][i] = wrap(m_home[Y][i], final<Y>(i), -1.0f - (edge_boundary / vertical_correction), 1.0f + (edge_boundary / vertical_correction));
+	}
 }
 
-Point &Sprite::home() {
-	return m_home;
-}
+void SpriteStore::update_faces(size_t first, size_t last) {
+	Range yonkers = range(YONKER);
 
-void Sprite::transform() {
-	glTranslated(final<X>(), final<Y>(), 0.0);
-	glScaled(m_size, m_size, 1.0);
+	for (size_t i = (std::max)(first, yonkers.first); i < (std::min)(last, yonkers.last); i++) {
+		m_textures[i] = Texture::get(m_textures[i]->palette(), bitmap_for_emotion(m_emotion_vector[i]));
+	}
 }
 
-void Sprite::update_trail() {
-	if (TrailSprite::get_trail_length() < 1) {
-		return;
+bool SpriteStore::advance_trails() {
+	size_t trail_samples = get_trail_samples();
+	if (trail_samples < 1) {
+		return false;
 	}
 
-	get_trail() = TrailSprite(m_texture, Point(final<X>(), final<Y>()));
-	increment_trail_index();
-}
-
-TrailSprite& Sprite::get_trail(const size_t index) {
-	return m_trail.at((m_trail_start_index + index) % TrailSprite::get_trail_length());
-}
+	// Only one frame in every TrailSpace is kept; draw() slides the trail along in between.
+	m_trail_phase = (m_trail_phase + 1) % get_trail_space();
+	if (m_trail_phase != 0) {
+		return false;
+	}
 
-void Sprite::increment_trail_index(const size_t amount) {
-	m_trail_start_index += amount;
-	m_trail_start_index %= TrailSprite::get_trail_length();
+	// Everyone's ring turns together, so the newest sample goes where the oldest one was.
+	m_trail_start_index = (m_trail_start_index + trail_samples - 1) % trail_samples;
+	return true;
 }
 
-void Sprite::draw_trail(Context &ctx) {
-	for (size_t i = 0; i < TrailSprite::get_trail_length(); i += TrailSprite::get_trail_space()) {
-		get_trail(i).draw(ctx);
+void SpriteStore::update_trails(size_t first, size_t last) {
+	for (size_t i = first; i < last; i++) {
+		trail(i, 0) = { Point(final<X>(i), final<Y>(i)), m_textures[i] };
 	}
 }
 
-Yonker::Yonker(const Texture *texture, const Point &home) 
-	: Sprite(texture, home), m_emotion_vector({ 0.0, 0.0, 0.0 }) { }
-
-void Yonker::update(Context &ctx) {
-	m_emotion_vector = emotion_vector(ctx);
-
-	auto abs_plus = [](double a, double b) -> double {
-		return a + abs(b);
-	};
-
-	double emotion_magnitude =
-		std::accumulate(m_emotion_vector.begin(), m_emotion_vector.end(), 0.0, abs_plus);
+const SpriteStore::TrailPoint &SpriteStore::trail(size_t i, size_t age) const {
+	size_t trail_samples = get_trail_samples();
+	return m_trails[i * trail_samples + (m_trail_start_index + age) % trail_samples];
+}
 
-	// In little steps up and down they'll roam,
-	// But never too far outside their home.
-	if (cfg[Cfg::HomeDrift] >= 0.000001) {
-		get<X>(m_relpos) = Noise::wiggle(
-			get<X>(m_relpos),
-			-cfg[Cfg::HomeDrift],
-			cfg[Cfg::HomeDrift],
-			cfg[Cfg::StepSize] * (emotion_magnitude * cfg[Cfg::ShakeFactor]) / max((cfg[Cfg::HomeDrift] / Cfg::HomeDrift.default_), 1)
-		);
+SpriteStore::TrailPoint &SpriteStore::trail(size_t i, size_t age) {
+	size_t trail_samples = get_trail_samples();
+	return m_trails[i * trail_samples + (m_trail_start_index + age) % trail_samples];
+}
 
-		get<Y>(m_relpos) = Noise::wiggle(
-			get<Y>(m_relpos),
-			-cfg[Cfg::HomeDrift],
-			cfg[Cfg::HomeDrift],
-			cfg[Cfg::StepSize] * (emotion_magnitude * cfg[Cfg::ShakeFactor]) / max((cfg[Cfg::HomeDrift] / Cfg::HomeDrift.default_), 1)
-		);
+int SpriteStore::get_trail_length() {
+	if (cfg[Cfg::TrailsEnabled] != 1.0) {
+		return 0;
 	}
 
-	Sprite::update(ctx);
+	int max_trail = (int) round(cfg[Cfg::MaxTrailCount] / cfg[Cfg::SpriteCount]);
+	return std::clamp((int) round(cfg[Cfg::TrailLength]) + 1, 1, max_trail) - 1;
+}
 
-	change_texture(Texture::get(m_texture->palette(), bitmap_for_current_emotion(ctx)));
+int SpriteStore::get_trail_samples() {
+	int trail_length = get_trail_length();
+	return trail_length > 0 ? trail_length + 1 : 0;
+}
 
-	update_trail();
+int SpriteStore::get_trail_space() {
+	return (int) (std::max)(round(cfg[Cfg::TrailSpace]), 1.0);
 }
 
-const BitmapData &Yonker::bitmap_for_current_emotion(Context &ctx) const {
-	auto emotion_map_index_of = [](double emotion) -> int {
+const BitmapData &SpriteStore::bitmap_for_emotion(const EmotionVector &emotion) {
+	auto emotion_map_index_of = [](Real emotion) -> int {
 		return std::clamp((int) round(emotion * cfg[Cfg::EmotionScale]), -1, 1) + 1;
 	};
 
-	int empathetic = emotion_map_index_of(m_emotion_vector[EMPATHY]);
-	int optimistic = emotion_map_index_of(m_emotion_vector[OPTIMISM]);
-	int ambitious = emotion_map_index_of(m_emotion_vector[AMBITION]);
+	int empathetic = emotion_map_index_of(emotion[EMPATHY]);
+	int optimistic = emotion_map_index_of(emotion[OPTIMISM]);
+	int ambitious = emotion_map_index_of(emotion[AMBITION]);
 
-	static Bitmaps::Definition emotion_map[3][3][3] = {
+	const static Bitmaps::Definition emotion_map[3][3][3] = {
 		// Go down through the layers, and the soul empathatic,
 		// Go down _within_ layers, and the heart optimistic,
 		// Go off towards the right, and the head energetic.
@@ -171,57 +375,148 @@ const BitmapData &Yonker::bitmap_for_current_emotion(Context &ctx) const {
 	return *emotion_map[empathetic][optimistic][ambitious].data;
 }
 
-std::array<double, Yonker::_EMOTIONS_COUNT> Yonker::emotion_vector(Context &ctx) const {
-	// Continous noise will be perfect for this;
-	// Nearby to those pissed will also be pissed.
-	return {
-		PerlinNoise::get(final<X>() + ctx.t(), final<Y>() + ctx.t(), ctx.t()),
-		PerlinNoise::get(final<X>() - ctx.t(), final<Y>() + ctx.t(), ctx.t()),
-		PerlinNoise::get(final<X>() + ctx.t(), final<Y>() - ctx.t(), ctx.t()),
-	};
+void EmotionBatch::update(SpriteStore &sprites, Context &ctx, WorkerPool &workers) {
+	SpriteStore::Range yonkers = sprites.range(SpriteStore::YONKER);
+	size_t yonker_count = yonkers.last - yonkers.first;
+
+	// Everyone gets a fresh look if we've skipped a beat (or never had one),
+	// since there's nothing recent to go on.
+	bool refresh_all = yonker_count != m_last_count || ctx.frame_count() != m_last_frame + 1;
+	m_last_count = yonker_count;
+	m_last_frame = ctx.frame_count();
+	size_t interval = cast<size_t>(std::clamp(round(cfg[Cfg::EmotionRefreshInterval]), 1.0, Cfg::EmotionRefreshInterval.range.second));
+	size_t phase = ctx.frame_count() % interval;
+
+	m_refreshing.clear();
+	for (size_t i = yonkers.first; i < yonkers.last; i++) {
+		if (refresh_all || (i - yonkers.first) % interval == phase) {
+			m_refreshing.push_back(i);
+		} else {
+			for (size_t e = 0; e < SpriteStore::_EMOTIONS_COUNT; e++) {
+				sprites.m_emotion_vector[i][e] += sprites.m_emotion_rate[i][e];
+			}
+		}
+	}
+
+	size_t count = m_refreshing.size() * SpriteStore::_EMOTIONS_COUNT;
+	m_xs.resize(count);
+	m_ys.resize(count);
+	m_zs.resize(count);
+	m_emotions.resize(count);
+
+	Real t = cast<Real>(ctx.t());
+	NoiseEngine engine = (NoiseEngine) cfg[Cfg::EmotionNoise];
+	// Straight from the registry, so it might be anything; NaN gets the default.
+	double volume_setting = std::isnan(cfg[Cfg::NoiseVolumeSize]) ? Cfg::NoiseVolumeSize.default_ : cfg[Cfg::NoiseVolumeSize];
+	int volume_size = cast<int>(std::clamp(volume_setting, Cfg::NoiseVolumeSize.range.first, Cfg::NoiseVolumeSize.range.second));
+
+	// Each chunk of Yonkers is sampled in a batch of its own. CHUNK * _EMOTIONS_COUNT is a
+	// whole number of SIMD lanes, so every sample goes down the same path whoever takes it.
+	workers.run(m_refreshing.size(), SpriteStore::CHUNK, [&](size_t first, size_t last) {
+		sample_chunk(sprites, first, last, t, engine, volume_size, refresh_all, interval);
+	});
 }
 
-// A strange sillouette appears in the dark...
-// That's no Llokin! That's something sinistrous!
-// The temper of character just misses the mark...
-// Emergency meeting! That's awfully suspicious!
-Impostor::Impostor(const PaletteData *palette, const Point &home)
-	: Sprite(Texture::of(palette, random_bitmap()), home) { }
+void EmotionBatch::save(SnapshotWriter &snapshot) const {
+	snapshot.put<uint64_t>(m_last_count);
+	snapshot.put<uint32_t>(m_last_frame);
+}
 
-void Impostor::update(Context &ctx) {
-	Sprite::update(ctx);
+bool EmotionBatch::load(SnapshotReader &snapshot) {
+	uint64_t last_count;
+	uint32_t last_frame;
+	if (!snapshot.get(last_count) || !snapshot.get(last_frame)) {
+		return false;
+	}
 
-	update_trail();
+	m_last_count = cast<size_t>(last_count);
+	m_last_frame = last_frame;
+	return true;
 }
 
-Bitmaps::Definition &Impostor::random_bitmap() {
-	static auto impostors = Bitmaps::bitmaps_of_group(BitmapGroup::Impostor);
-	static auto yoy = Bitmaps::bitmaps_of_group(BitmapGroup::YoyImpostor);
+void EmotionBatch::sample_chunk(SpriteStore &sprites, size_t first, size_t last, Real t,
+                                NoiseEngine engine, int volume_size, bool refresh_all, size_t interval) {
+	// Continous noise will be perfect for this;
+	// Nearby to those pissed will also be pissed.
+	//
+	// The coordinates are worked out in Real, and only narrowed to float here, as they go
+	// into the staging buffers, because that's all the noise kernels take.
+	for (size_t r = first; r < last; r++) {
+		Real x = sprites.final<X>(m_refreshing[r]);
+		Real y = sprites.final<Y>(m_refreshing[r]);
+		size_t base = r * SpriteStore::_EMOTIONS_COUNT;
 
-	if (Noise::random() < 0.5) {
-		return impostors[(int) (Noise::random() * impostors.size())];
-	} else {
-		return yoy[(int) (Noise::random() * yoy.size())];
+		m_xs[base + SpriteStore::OPTIMISM] = cast<float>(x + t);
+		m_ys[base + SpriteStore::OPTIMISM] = cast<float>(y + t);
+
+		m_xs[base + SpriteStore::EMPATHY] = cast<float>(x - t);
+		m_ys[base + SpriteStore::EMPATHY] = cast<float>(y + t);
+
+		m_xs[base + SpriteStore::AMBITION] = cast<float>(x + t);
+		m_ys[base + SpriteStore::AMBITION] = cast<float>(y - t);
+
+		std::fill_n(m_zs.begin() + base, SpriteStore::_EMOTIONS_COUNT, cast<float>(t));
+	}
+
+	size_t base = first * SpriteStore::_EMOTIONS_COUNT;
+	size_t count = (last - first) * SpriteStore::_EMOTIONS_COUNT;
+	NoiseField::get_many(engine, volume_size, m_xs.data() + base, m_ys.data() + base, m_zs.data() + base, m_emotions.data() + base, count);
+
+	for (size_t r = first; r < last; r++) {
+		size_t i = m_refreshing[r];
+
+		for (size_t e = 0; e < SpriteStore::_EMOTIONS_COUNT; e++) {
+			Real sample = m_emotions[r * SpriteStore::_EMOTIONS_COUNT + e];
+
+			sprites.m_emotion_rate[i][e] = refresh_all ? Real(0) : (sample - sprites.m_emotion_sample[i][e]) / interval;
+			sprites.m_emotion_sample[i][e] = sample;
+			sprites.m_emotion_vector[i][e] = sample;
+		}
 	}
 }
 
-TrailSprite::TrailSprite(const Texture *texture, const Point &home)
-	: Sprite(texture, home, false) { }
+void DriftBatch::update(SpriteStore &sprites, Context &ctx, WorkerPool &workers) {
+	if (cfg[Cfg::HomeDrift] < 0.000001) {
+		return;
+	}
 
-void TrailSprite::update(Context &ctx) { }
+	// Everything but the emotions is the same for everyone, so work it out just the once.
+	double step_factor = cfg[Cfg::StepSize] * cfg[Cfg::ShakeFactor] / (std::max)(cfg[Cfg::HomeDrift] / Cfg::HomeDrift.default_, 1.0);
 
-void TrailSprite::draw_trail(Context &ctx) { }
+	// The Xs come first, then the Ys.
+	SpriteStore::Range yonkers = sprites.range(SpriteStore::YONKER);
+	size_t n = yonkers.last - yonkers.first;
+	m_values.resize(n * 2);
+	m_steps.resize(n * 2);
+	m_draws.resize(n * 4);
 
-int TrailSprite::get_trail_length() {
-	if (cfg[Cfg::TrailsEnabled] != 1.0) {
-		return 0;
+	for (size_t j = 0; j < n; j++) {
+		size_t i = yonkers.first + j;
+
+		double emotion_magnitude = 0.0;
+		for (Real emotion : sprites.m_emotion_vector[i]) {
+			emotion_magnitude += std::abs(emotion);
+		}
+
+		m_values[j] = sprites.m_relpos[X][i];
+		m_values[n + j] = sprites.m_relpos[Y][i];
+		m_steps[j] = m_steps[n + j] = emotion_magnitude * step_factor;
 	}
 
-	int max_trail = (int) round(cfg[Cfg::MaxTrailCount] / cfg[Cfg::SpriteCount]);
-	int trail_length = std::clamp((int) round(cfg[Cfg::TrailLength]) + 1, 1, max_trail) - 1;
-	return trail_length * get_trail_space();
-}
+	// The dice are all rolled here, in order, so it doesn't matter who wiggles whom.
+	ctx.rng().fill(m_draws.data(), m_draws.size());
 
-int TrailSprite::get_trail_space() {
-	return (int) max(round(cfg[Cfg::TrailSpace]), 1);
+	double limit = cfg[Cfg::HomeDrift];
+	workers.run(n, SpriteStore::CHUNK, [&](size_t first, size_t last) {
+		// Xs, then Ys.
+		for (size_t offset : { (size_t) 0, n }) {
+			size_t at = offset + first;
+			Noise::wiggle_many(m_values.data() + at, m_steps.data() + at, m_draws.data() + at, m_draws.data() + n * 2 + at, limit, last - first);
+		}
+
+		for (size_t j = first; j < last; j++) {
+			sprites.m_relpos[X][yonkers.first + j] = cast<Real>(m_values[j]);
+			sprites.m_relpos[Y][yonkers.first + j] = cast<Real>(m_values[n + j]);
+		}
+	});
 }
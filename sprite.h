@@ -13,78 +13,177 @@
 
 #include "context.h"
 #include "graphics.h"
-
-class TrailSprite;
-
-class Sprite : public Identifiable<Empty> {
+#include "noise.h"
+#include "workers.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// Every sprite on screen, kept as one array per field rather than one object per sprite,
+// so a pass over the crowd walks straight through memory instead of from pointer to pointer.
+// A sprite is just an index into it.
+//
+// The Yonkers come first and the Impostors after them, so anything that only
+// concerns one kind can run over its own range and leave the other alone.
+class SpriteStore {
 public:
-	Sprite(const Texture *texture, const Point &home, const bool has_trail = true);
-
-	void change_texture(const Texture *texture);
-	virtual void draw(Context &ctx);
-	virtual void update(Context &ctx);
-
-	template <int C> double final() const {
-		return std::get<C>(m_home) + std::get<C>(m_relpos);
-	}
-
-	Point &home();
-
-protected:
-	void transform();
-	void update_trail();
-	void increment_trail_index(const size_t amount = 1);
-	TrailSprite& get_trail(const size_t index = 0);
-	virtual void draw_trail(Context &ctx);
-
-	const Texture *m_texture;
-	Point m_relpos;
-	Point m_home;
-	GLdouble m_size;
-	std::vector<TrailSprite> m_trail;
-	size_t m_trail_start_index;
-};
+	enum Kind : unsigned char {
+		YONKER = 0,
+		IMPOSTOR = 1,
+		_KIND_COUNT
+	};
 
-class Yonker : public Sprite {
-public:
 	enum Emotion {
 		OPTIMISM = 0,
 		EMPATHY = 1,
 		AMBITION = 2,
 		_EMOTIONS_COUNT
 	};
-	using EmotionVector = std::array<double, _EMOTIONS_COUNT>;
+	using EmotionVector = std::array<Real, _EMOTIONS_COUNT>;
 
-	Yonker(const Texture *texture, const Point &home);
+	// How many sprites a worker takes at a time.
+	constexpr static size_t CHUNK = 256;
 
-	virtual void update(Context &ctx) override;
+	// Where one sprite was, and what it looked like there, some frames ago.
+	struct TrailPoint {
+		Point position;
+		const Texture *texture;
+	};
 
-protected:
-	const BitmapData &bitmap_for_current_emotion(Context &ctx) const;
-	EmotionVector emotion_vector(Context &ctx) const;
+	// Everyone of one kind, as [first, last).
+	struct Range {
+		size_t first;
+		size_t last;
+	};
 
-	EmotionVector m_emotion_vector;
-};
+	// Sprites are added in kind order: all the Yonkers, then all the Impostors.
+	size_t add(Kind kind, const Texture *texture, const Point &home);
 
-class Impostor : public Sprite {
-public:
-	Impostor(const PaletteData *palette, const Point &home);
+	size_t size() const;
+	Range range(Kind kind) const;
 
-	virtual void update(Context &ctx) override;
+	Id id(size_t i) const;
+	Kind kind(size_t i) const;
+	const Texture *texture(size_t i) const;
+	Real size(size_t i) const;
 
-protected:
-	static Bitmaps::Definition &random_bitmap();
-};
+	template <int C> Real &home(size_t i) {
+		return m_home[C][i];
+	}
 
-class TrailSprite : public Sprite {
-public:
-	TrailSprite(const Texture *palette, const Point &home);
+	template <int C> Real &relpos(size_t i) {
+		return m_relpos[C][i];
+	}
+
+	template <int C> Real final(size_t i) const {
+		return m_home[C][i] + m_relpos[C][i];
+	}
+
+	EmotionVector &emotion(size_t i);
+
+	// Wraps everyone around the screen's edges, picks the Yonkers' faces
+	// for how they feel, and leaves a trail behind. Once per frame, after the
+	// patterns have moved everyone and the batches have done their part.
+	void update(Context &ctx, WorkerPool &workers);
+
+	// Keeps where everyone is now as where they were last step. Call it before each step.
+	void remember_positions();
+
+	// Everyone a fraction blend of the way from where they were last step
+	// to where they are now, so the picture moves smoothly between steps.
+	void draw(Context &ctx, Real blend);
+	// A ring around everyone, radii across and down, wherever draw() puts them for the same blend.
+	void draw_outlines(const Point &radii, Real blend);
 
-	virtual void update(Context &ctx) override;
+	// Everyone, all of who they are and where they've been. Loading only takes
+	// if it all makes sense, and the trails are as long as cfg says they should be now.
+	void save(SnapshotWriter &snapshot) const;
+	bool load(SnapshotReader &snapshot);
 
+	// How many points of trail each sprite leaves, and how many frames apart they are.
 	static int get_trail_length();
 	static int get_trail_space();
 
-protected:
-	virtual void draw_trail(Context &ctx) override;
+private:
+	friend class EmotionBatch;
+	friend class DriftBatch;
+	friend class Playback;
+
+	// A fraction w of the way from a to b, or whichever's nearer if they're across a wrap.
+	static Point between(const Point &a, const Point &b, Real w);
+
+	void wrap(size_t first, size_t last, Real horizontal_correction, Real vertical_correction);
+	void update_faces(size_t first, size_t last);
+	// Turns the trail rings, and says whether this frame gets a sample.
+	bool advance_trails();
+	void update_trails(size_t first, size_t last);
+
+	// A sprite's trail samples, newest (age 0) to oldest.
+	const TrailPoint &trail(size_t i, size_t age) const;
+	TrailPoint &trail(size_t i, size_t age);
+
+	static int get_trail_samples();
+
+	static const BitmapData &bitmap_for_emotion(const EmotionVector &emotion);
+
+	std::vector<Id> m_ids;
+	std::vector<Kind> m_kinds;
+	std::array<std::vector<Real>, 2> m_home;
+	std::array<std::vector<Real>, 2> m_relpos;
+	std::array<std::vector<Real>, 2> m_previous;
+	std::vector<Real> m_sizes;
+	std::vector<const Texture *> m_textures;
+
+	std::vector<EmotionVector> m_emotion_vector;
+	std::vector<EmotionVector> m_emotion_sample;
+	std::vector<EmotionVector> m_emotion_rate;
+
+	// Every sprite's trail is a ring of get_trail_samples() points, one after the other.
+	// Only the frames a trail point is drawn at are kept, plus one more, so draw()
+	// has two samples to put each point between.
+	std::vector<TrailPoint> m_trails;
+	size_t m_trail_start_index = 0;
+	// Frames since the newest sample was taken.
+	size_t m_trail_phase = 0;
+
+	std::array<size_t, _KIND_COUNT> m_kind_counts = {};
+};
+
+// Feels every Yonker's feelings in one go, so the noise can be sampled in bulk.
+// Run it once per frame, after the sprites have moved and before they update.
+//
+// With an EmotionRefreshInterval of k, each frame only samples every kth Yonker,
+// rotating through them, and the others extrapolate from their last two samples.
+class EmotionBatch {
+public:
+	void update(SpriteStore &sprites, Context &ctx, WorkerPool &workers);
+
+	void save(SnapshotWriter &snapshot) const;
+	bool load(SnapshotReader &snapshot);
+
+private:
+	void sample_chunk(SpriteStore &sprites, size_t first, size_t last, Real t,
+	                  NoiseEngine engine, int volume_size, bool refresh_all, size_t interval);
+
+	std::vector<size_t> m_refreshing;
+	// Staging for NoiseField::get_many, which only samples in float.
+	std::vector<float> m_xs;
+	std::vector<float> m_ys;
+	std::vector<float> m_zs;
+	std::vector<float> m_emotions;
+	size_t m_last_count = 0;
+	unsigned int m_last_frame = 0;
+};
+
+// In little steps up and down they'll roam,
+// But never too far outside their home.
+// Wiggles every Yonker away from its home at once; run it after their emotions are in.
+class DriftBatch {
+public:
+	void update(SpriteStore &sprites, Context &ctx, WorkerPool &workers);
+
+private:
+	std::vector<double> m_values;
+	std::vector<double> m_steps;
+	std::vector<double> m_draws;
 };
@@ -2,16 +2,38 @@
 #include "bitmaps.h"
 #include "config.h"
 #include "noise.h"
-#include "configdialog.h"
+#include "snapshot.h"
 
 #include <math.h>
 
 using std::get;
 
-SpriteGenerator::SpriteGenerator() {
-	using namespace std::chrono;
-	auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-	std::srand(cast<unsigned int>(now));
+// How far something gets in one frame, for a distance that'd take a whole time unit.
+// The clock keeps counting in doubles, since it only ever goes up; what it works out
+// to lands in Real, along with everything else that has a position.
+static Real per_frame(double distance) {
+	return cast<Real>(distance / cfg[Cfg::TimeDivisor]);
+}
+
+Point bubble_radii(Context *ctx) {
+	const double SCREEN_SIZE = ctx->rect().bottom * ctx->rect().right;
+	const Real STRETCH_RATIO = cast<Real>((double) (ctx->rect().bottom) / ctx->rect().right);
+	const Real BUBBLE_Y_RADIUS = cast<Real>((10.0 / (cfg[Cfg::SpriteCount] / 1.5 + 40.0)) * std::pow(SCREEN_SIZE / (1080 * 1920) / 3.0 + 0.7, 1.1));
+
+	return Point(BUBBLE_Y_RADIUS * STRETCH_RATIO, BUBBLE_Y_RADIUS);
+}
+
+SpriteGenerator::SpriteGenerator(Context *ctx) : m_ctx(ctx) {
+	// A seed of 0 means "surprise me", and so does anything outside the range, or not a
+	// number at all, rather than whatever casting it would happen to give. Anything else
+	// replays the same session.
+	double seed = cfg[Cfg::Seed];
+	if (seed > Cfg::Seed.range.first && seed <= Cfg::Seed.range.second) {
+		ctx->streams().seed(cast<uint64_t>(seed));
+	} else {
+		using namespace std::chrono;
+		ctx->streams().seed(cast<uint64_t>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count()));
+	}
 
 	PaletteGroup palette_group = (PaletteGroup) (cfg[Cfg::Palette]);
 
@@ -19,8 +41,9 @@ SpriteGenerator::SpriteGenerator() {
 	if (cfg[Cfg::UseCustomPalettes] == 1.0f) {
 		bag_of_palettes = PaletteRepository().get_all_custom_palettes();
 	} else if (palette_group == PaletteGroup::RandomlyGenerated) {
+		RandomPalettes random_palettes(ctx->rng(RandomStream::Palettes));
 		for (int i = cast<int>(Cfg::MaxColors.range.first); i < Cfg::MaxColors.range.second; i++) {
-			bag_of_palettes.push_back(RandomPalettes::random(i));
+			bag_of_palettes.push_back(random_palettes.random());
 		}
 	} else {
 		auto group = PaletteGroups::get(palette_group);
@@ -38,25 +61,38 @@ SpriteGenerator::SpriteGenerator() {
 	max_colors = std::clamp(max_colors, min_colors, (int) bag_of_palettes.size());
 
 	for (int i = 0; i < max_colors; i++) {
-		size_t random_palette_index = std::rand() % bag_of_palettes.size();
+		size_t random_palette_index = ctx->rng(RandomStream::Sprites).below(cast<uint32_t>(bag_of_palettes.size()));
 		m_palettes.push_back(bag_of_palettes[random_palette_index].data);
 		bag_of_palettes.erase(bag_of_palettes.begin() + random_palette_index);
 	}
 }
 
-std::vector<Sprite *> SpriteGenerator::make(unsigned int n) const {
-	Sprites sprites;
+Sprites SpriteGenerator::make(unsigned int n) const {
+	// The store wants its Yonkers first, so line everyone up before letting them in.
+	std::vector<std::pair<Point, const Texture *>> yonkers;
+	std::vector<std::pair<Point, const Texture *>> impostors;
 
 	for (double y = -1.2; y < 1.2; y += 1.0 / sqrt(cfg[Cfg::SpriteCount])) {
 		for (double x = -1.2; x < 1.2; x += 1.0 / sqrt(cfg[Cfg::SpriteCount])) {
-			if (Noise::random() < pow(cfg[Cfg::ImpostorChance], 3)) {
-				sprites.push_back(new Impostor(next_palette(), Point(x, y)));
+			Point home = Point(cast<Real>(x), cast<Real>(y));
+
+			if (m_ctx->rng(RandomStream::Sprites).uniform() < pow(cfg[Cfg::ImpostorChance], 3)) {
+				const PaletteData *palette = next_palette();
+				impostors.push_back({ home, Texture::of(palette, random_impostor_bitmap()) });
 			} else {
-				sprites.push_back(new Yonker(next_texture(), { x, y }));
+				yonkers.push_back({ home, next_texture() });
 			}
 		}
 	}
 
+	Sprites sprites;
+	for (const auto &[home, texture] : yonkers) {
+		sprites.add(SpriteStore::YONKER, texture, home);
+	}
+	for (const auto &[home, texture] : impostors) {
+		sprites.add(SpriteStore::IMPOSTOR, texture, home);
+	}
+
 	return sprites;
 }
 
@@ -69,17 +105,35 @@ const PaletteData *SpriteGenerator::next_palette() const {
 	// You'd be kicked outta Vegas for logarithmic repeating.
 	while (true) {
 		for (auto palette : m_palettes) {
-			if (Noise::random() < 1.8 / cfg[Cfg::MaxColors]) {
+			if (m_ctx->rng(RandomStream::Sprites).uniform() < 1.8 / cfg[Cfg::MaxColors]) {
 				return palette;
 			}
 		}
 	}
 }
 
-SpriteChoreographer::SpriteChoreographer(PatternName choreography, Sprites *sprites, Context *ctx)
-	: m_pattern(choreography), m_ctx(ctx), m_sprites(sprites)
+// A strange sillouette appears in the dark...
+// That's no Llokin! That's something sinistrous!
+// The temper of character just misses the mark...
+// Emergency meeting! That's awfully suspicious!
+Bitmaps::Definition &SpriteGenerator::random_impostor_bitmap() const {
+	static auto impostors = Bitmaps::bitmaps_of_group(BitmapGroup::Impostor);
+	static auto yoy = Bitmaps::bitmaps_of_group(BitmapGroup::YoyImpostor);
+
+	Random &rng = m_ctx->rng(RandomStream::Sprites);
+
+	if (rng.uniform() < 0.5) {
+		return impostors[rng.below(cast<uint32_t>(impostors.size()))];
+	} else {
+		return yoy[rng.below(cast<uint32_t>(yoy.size()))];
+	}
+}
+
+SpriteChoreographer::SpriteChoreographer(PatternName choreography, Sprites *sprites, Context *ctx, WorkerPool *workers)
+	: m_sprites(sprites), m_ctx(ctx), m_pattern(choreography), m_hash_offset(1)
 { 
-	m_players = { new SinglePassPlayer(sprites, ctx), new GlobalPlayer(sprites, ctx) };
+	m_players.push_back(std::make_unique<SinglePassPlayer>(sprites, ctx, workers));
+	m_players.push_back(std::make_unique<GlobalPlayer>(sprites, ctx, workers));
 	update_player();
 }
 
@@ -90,6 +144,55 @@ void SpriteChoreographer::update() {
 	}
 }
 
+PatternName SpriteChoreographer::pattern() const {
+	return m_pattern;
+}
+
+void SpriteChoreographer::save(SnapshotWriter &snapshot) const {
+	snapshot.put<uint32_t>(m_pattern);
+	snapshot.put<uint32_t>(m_hash_offset);
+	for (const std::unique_ptr<PatternPlayer> &player : m_players) {
+		player->save(snapshot);
+	}
+}
+
+bool SpriteChoreographer::read(SnapshotReader &snapshot, size_t sprite_count, Saved &saved) const {
+	uint32_t pattern = 0;
+	uint32_t hash_offset = 0;
+	if (!snapshot.get(pattern) || !snapshot.get(hash_offset) || pattern >= _PATTERN_COUNT) {
+		return false;
+	}
+
+	saved.pattern = (PatternName) pattern;
+	saved.hash_offset = hash_offset;
+	saved.players.resize(m_players.size());
+
+	for (size_t p = 0; p < m_players.size(); p++) {
+		if (!m_players[p]->read(snapshot, sprite_count, saved.players[p])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SpriteChoreographer::apply(Saved &&saved) {
+	m_pattern = saved.pattern;
+	m_hash_offset = saved.hash_offset;
+
+	for (size_t p = 0; p < m_players.size(); p++) {
+		m_players[p]->apply(std::move(saved.players[p]));
+	}
+
+	// Like update_player(), except the pattern carries on from where it was saved instead of starting over.
+	for (const std::unique_ptr<PatternPlayer> &player : m_players) {
+		if (player->compatible_patterns().find(m_pattern) != player->compatible_patterns().end()) {
+			m_current_player = player.get();
+			m_current_player->m_hash_offset = m_hash_offset;
+		}
+	}
+}
+
 bool SpriteChoreographer::should_change_pattern() {
 	if (cfg[Cfg::IsPatternFixed]) {
 		return false;
@@ -101,234 +204,717 @@ bool SpriteChoreographer::should_change_pattern() {
 }
 
 void SpriteChoreographer::change_pattern() {
-	m_pattern = (PatternName) (Noise::random() * cast<double>(_PATTERN_COUNT));
+	m_pattern = (PatternName) (m_ctx->rng(RandomStream::Patterns).uniform() * cast<double>(_PATTERN_COUNT));
+	m_hash_offset++;
 	update_player();
 }
 
 void SpriteChoreographer::update_player() {
-	for (PatternPlayer *player : m_players) {
+	for (const std::unique_ptr<PatternPlayer> &player : m_players) {
 		if (player->compatible_patterns().find(m_pattern) != player->compatible_patterns().end()) {
-			m_current_player = player;
-			m_current_player->set_pattern(m_pattern);
+			m_current_player = player.get();
+			m_current_player->set_pattern(m_pattern, m_hash_offset);
 		}
 	}
 }
 
-void PatternPlayer::set_pattern(PatternName pattern) {
+void PatternPlayer::set_pattern(PatternName pattern, unsigned int hash_offset) {
 	m_pattern = pattern;
-	m_hash_offset++;
+	m_hash_offset = hash_offset;
+
+	// Whatever the last pattern was keeping track of, this one starts with a clean slate.
+	m_state.reset();
+	init_state();
 }
 
-PatternPlayer::PatternPlayer(Sprites *sprites, Context *ctx)
-	: m_pattern(Roamers), m_sprites(sprites), m_ctx(ctx) { }
+void PatternState::reset() {
+	directions.clear();
+	for (std::vector<Real> &velocity : velocities) {
+		velocity.clear();
+	}
+	flow.resize(0, 0);
+}
 
-double PatternPlayer::hash(unsigned int n) {
-	return ((n * n * 562448657) % 4096) / 4096.0;
+void PatternPlayer::save(SnapshotWriter &snapshot) const {
+	snapshot.put<uint32_t>(m_pattern);
+	m_emotions.save(snapshot);
+
+	snapshot.put(m_state.directions);
+	snapshot.put(m_state.velocities[X]);
+	snapshot.put(m_state.velocities[Y]);
+	m_state.flow.save(snapshot);
 }
 
-unsigned int PatternPlayer::m_hash_offset = 0;
+bool PatternPlayer::read(SnapshotReader &snapshot, size_t sprite_count, Saved &saved) const {
+	saved.emotions = m_emotions;
+
+	uint32_t pattern;
+	if (!snapshot.get(pattern) || pattern >= _PATTERN_COUNT || !saved.emotions.load(snapshot)) {
+		return false;
+	}
 
-SinglePassPlayer::SinglePassPlayer(Sprites *sprites, Context *ctx)
-	: PatternPlayer(sprites, ctx) { }
+	PatternState &state = saved.state;
+	snapshot.get(state.directions);
+	snapshot.get(state.velocities[X]);
+	snapshot.get(state.velocities[Y]);
+	bool flowing = state.flow.load(snapshot);
+
+	// Everything kept is either for everyone or not kept at all, and whatever the saved
+	// pattern moves by has to be there; its kernel indexes it without looking.
+	bool bouncing = pattern == Bouncy;
+	bool moving = pattern == Bubbles || pattern == Flock || pattern == Orbit;
+	bool stirring = pattern == Currents;
+	auto fits = [&](size_t size, bool needed) {
+		return size == sprite_count || (size == 0 && !needed);
+	};
 
-void SinglePassPlayer::update() {
-	for (Sprite *sprite : *m_sprites) {
-		move_functions[m_pattern](sprite, m_ctx, hash(sprite->id() + m_hash_offset));
-		sprite->update(*m_ctx);
+	if (!snapshot.ok() || !flowing || !fits(state.directions.size(), bouncing)
+		|| !fits(state.velocities[X].size(), moving) || !fits(state.velocities[Y].size(), moving)
+		|| (stirring && (state.flow.width() == 0 || state.flow.height() == 0))) {
+		return false;
 	}
+
+	saved.pattern = (PatternName) pattern;
+	return true;
 }
- 
-std::set<PatternName> &SinglePassPlayer::compatible_patterns() {
-	static std::set<PatternName> patterns = {
-		Roamers,
-		Waves,
-		Square,
-		Bouncy,
-		Lissajous,
-		Rose,
-		Lattice,
-	};
 
-	return patterns;
+void PatternPlayer::apply(Saved &&saved) {
+	m_pattern = saved.pattern;
+	m_emotions = std::move(saved.emotions);
+	m_state = std::move(saved.state);
+}
+
+PatternPlayer::PatternPlayer(Sprites *sprites, Context *ctx, WorkerPool *workers)
+	: m_hash_offset(0), m_pattern(Roamers), m_sprites(sprites), m_ctx(ctx), m_workers(workers) { }
+
+void PatternPlayer::update_sprites() {
+	{
+		StageClock::Scope timing(m_ctx->stages(), Stage::Emotions);
+		m_emotions.update(*m_sprites, *m_ctx, *m_workers);
+	}
+	{
+		StageClock::Scope timing(m_ctx->stages(), Stage::Drift);
+		m_drift.update(*m_sprites, *m_ctx, *m_workers);
+	}
+	{
+		StageClock::Scope timing(m_ctx->stages(), Stage::Sprites);
+		m_sprites->update(*m_ctx, *m_workers);
+	}
+}
+
+Real PatternPlayer::hash(unsigned int n) {
+	return cast<Real>(((n * n * 562448657) % 4096) / 4096.0);
 }
 
-std::map<PatternName, SinglePassPlayer::MoveFunction> SinglePassPlayer::move_functions {
-	{ Roamers, [](Sprite* sprite, Context* ctx, double offset) {
-		// Every pattern is made of three things!
-		// The sprite, the creature who kindly participates -
-		// The context, the timepiece by which we will calculate -
-		// And the offset, by which our fate is encoded
-		// One onto zero that chaos corroded.
-		get<X>(sprite->home()) += offset / cfg[Cfg::TimeDivisor];
-		get<Y>(sprite->home()) += sin(ctx->t() * offset) / cfg[Cfg::TimeDivisor];
-	}},
-	{ Waves, [](Sprite *sprite, Context *ctx, double offset) {
-		get<X>(sprite->home()) += sin(ctx->t() * offset) / cfg[Cfg::TimeDivisor];
-		get<Y>(sprite->home()) += cos(ctx->t() * offset) / cfg[Cfg::TimeDivisor];
-	}},
-	{ Square, [](Sprite *sprite, Context *ctx, double offset) {
-		get<X>(sprite->home()) += offset < 0.5 ? ((1.0 - offset) / cfg[Cfg::TimeDivisor]) : 0.0;
-		get<Y>(sprite->home()) += offset < 0.5 ? 0.0: (offset / cfg[Cfg::TimeDivisor]);
-	}},
-	{ Bouncy, [](Sprite *sprite, Context *ctx, double offset) {
-		static int NorthWest = 0b01;
-		static int NorthEast = 0b00;
-		static int SouthEast = 0b10;
-		static int SouthWest = 0b11;
-		static int West = 0b1;
-		static int South = 0b10;
-
-		static std::map<Id, int> directions;
-
-		double lateral_modifier = (directions[sprite->id()] & West) ? -1.0 : 1.0;
-		double vertical_modifier = (directions[sprite->id()] & South) ? -1.0 : 1.0;
-
-		get<X>(sprite->home()) += (offset / cfg[Cfg::TimeDivisor]) * lateral_modifier;
-		get<Y>(sprite->home()) += (1.0 - offset) / cfg[Cfg::TimeDivisor] * vertical_modifier;
-
-		if (get<X>(sprite->home()) > 1.0 || get<X>(sprite->home()) < -1.0) {
-			directions[sprite->id()] ^= West;
-			get<X>(sprite->home()) = signbit(get<X>(sprite->home())) ? -1.0 : 1.0;
+// Every pattern is a kernel: a struct that's made once a frame, so whatever's the same
+// for everyone that frame is worked out once, and then moves the sprites. Each player
+// has a list of the kernels it plays, and picks one per frame; past that, the loop
+// over the sprites knows exactly what it's calling, and can inline it.
+//
+// To add a pattern, write its kernel and put it in a player's list. If it keeps
+// anything in a PatternState, it should also have an init() to set that up.
+template <typename... Kernels> struct KernelList {
+	static std::set<PatternName> names() {
+		return { Kernels::NAME... };
+	}
+
+	// Makes the kernel for pattern and hands it to play. Nothing happens for a pattern not on the list.
+	template <typename Play> static void dispatch(PatternName pattern, Context *ctx, Play &&play) {
+		(void) ((pattern == Kernels::NAME ? (play(Kernels(ctx)), true) : false) || ...);
+	}
+};
+
+struct RoamersKernel {
+	constexpr static PatternName NAME = Roamers;
+
+	RoamersKernel(Context *ctx) : t(ctx->t()) { }
+
+	// Every pattern is made of three things!
+	// The sprite, the creature who kindly participates -
+	// The context, the timepiece by which we will calculate -
+	// And the offset, by which our fate is encoded
+	// One onto zero that chaos corroded.
+	void move(Sprites *sprites, size_t i, Real offset, PatternState &) const {
+		sprites->home<X>(i) += per_frame(offset);
+		sprites->home<Y>(i) += per_frame(sin(t * offset));
+	}
+
+	double t;
+};
+
+struct WavesKernel {
+	constexpr static PatternName NAME = Waves;
+
+	WavesKernel(Context *ctx) : t(ctx->t()) { }
+
+	void move(Sprites *sprites, size_t i, Real offset, PatternState &) const {
+		sprites->home<X>(i) += per_frame(sin(t * offset));
+		sprites->home<Y>(i) += per_frame(cos(t * offset));
+	}
+
+	double t;
+};
+
+struct SquareKernel {
+	constexpr static PatternName NAME = Square;
+
+	SquareKernel(Context *) { }
+
+	void move(Sprites *sprites, size_t i, Real offset, PatternState &) const {
+		sprites->home<X>(i) += offset < 0.5f ? per_frame(1.0 - offset) : Real(0);
+		sprites->home<Y>(i) += offset < 0.5f ? Real(0) : per_frame(offset);
+	}
+};
+
+struct BouncyKernel {
+	constexpr static PatternName NAME = Bouncy;
+
+	constexpr static unsigned char NorthEast = 0b00;
+	constexpr static unsigned char West = 0b1;
+	constexpr static unsigned char South = 0b10;
+
+	BouncyKernel(Context *) { }
+
+	void init(Sprites *sprites, PatternState &state) const {
+		// Everyone sets off north-east.
+		state.directions.assign(sprites->size(), NorthEast);
+	}
+
+	void move(Sprites *sprites, size_t i, Real offset, PatternState &state) const {
+		unsigned char &direction = state.directions[i];
+
+		Real lateral_modifier = (direction & West) ? Real(-1) : Real(1);
+		Real vertical_modifier = (direction & South) ? Real(-1) : Real(1);
+
+		sprites->home<X>(i) += per_frame(offset) * lateral_modifier;
+		sprites->home<Y>(i) += per_frame(1.0 - offset) * vertical_modifier;
+
+		if (sprites->home<X>(i) > 1.0f || sprites->home<X>(i) < -1.0f) {
+			direction ^= West;
+			sprites->home<X>(i) = signbit(sprites->home<X>(i)) ? Real(-1) : Real(1);
 		}
 
-		if (get<Y>(sprite->home()) > 1.0 || get<Y>(sprite->home()) < -1.0) {
-			directions[sprite->id()] ^= South;
-			get<Y>(sprite->home()) = signbit(get<Y>(sprite->home())) ? -1.0 : 1.0;
+		if (sprites->home<Y>(i) > 1.0f || sprites->home<Y>(i) < -1.0f) {
+			direction ^= South;
+			sprites->home<Y>(i) = signbit(sprites->home<Y>(i)) ? Real(-1) : Real(1);
 		}
-	}},
-	{ Lissajous, [](Sprite *sprite, Context *ctx, double offset) {
-		// Unlike the patterns you see above,
-		// For this one, well, push comes to shove.
-		// We know exactly where we must be,
-		// So we won't let our sprites roam around freely...
-		double target_x = sin(ctx->t() - (offset * 0.07 * cfg[Cfg::SpriteCount])) * 0.8;
-		double target_y = cos(ctx->t() - (offset * 0.05 * cfg[Cfg::SpriteCount])) * 0.8;
+	}
+};
+
+struct LissajousKernel {
+	constexpr static PatternName NAME = Lissajous;
+
+	LissajousKernel(Context *ctx) : t(ctx->t()), sprite_count(cfg[Cfg::SpriteCount]) { }
+
+	// Unlike the patterns you see above,
+	// For this one, well, push comes to shove.
+	// We know exactly where we must be,
+	// So we won't let our sprites roam around freely...
+	void move(Sprites *sprites, size_t i, Real offset, PatternState &) const {
+		Real target_x = cast<Real>(sin(t - (offset * 0.07 * sprite_count)) * 0.8);
+		Real target_y = cast<Real>(cos(t - (offset * 0.05 * sprite_count)) * 0.8);
 
 		// But! To send them straight to their fate is unsightly,
 		// So instead of assign, we just push ever lightly.
-		get<X>(sprite->home()) = target_x + (get<X>(sprite->home()) - target_x) * 0.9;
-		get<Y>(sprite->home()) = target_y + (get<Y>(sprite->home()) - target_y) * 0.9;
-	}},
-	{ Rose, [](Sprite *sprite, Context *ctx, double offset) {
-		double t = ctx->t() - (offset * 0.03 * cfg[Cfg::SpriteCount]);
-		double r = 0.04 * cfg[Cfg::SpriteCount] * t;
-
-		double target_x = sin(r) * cos(t) * 0.8;
-		double target_y = sin(r) * sin(t) * 0.8;
-
-		get<X>(sprite->home()) = target_x + (get<X>(sprite->home()) - target_x) * 0.9;
-		get<Y>(sprite->home()) = target_y + (get<Y>(sprite->home()) - target_y) * 0.9;
-	}},
-	{ Lattice, [](Sprite *_sprite, Context *_ctx, double _offset) {
-		// The flocking of birds, the schooling of fish,
-		// The dancing of insects with a firefly's wish...
-		// There's beauty in movement, I must agree,
-		// But beauty in stillness, I also can see.
-	}}
+		sprites->home<X>(i) = target_x + (sprites->home<X>(i) - target_x) * Real(0.9);
+		sprites->home<Y>(i) = target_y + (sprites->home<Y>(i) - target_y) * Real(0.9);
+	}
+
+	double t;
+	double sprite_count;
 };
 
-GlobalPlayer::GlobalPlayer(Sprites *sprites, Context *ctx)
-	: PatternPlayer(sprites, ctx) { }
+struct RoseKernel {
+	constexpr static PatternName NAME = Rose;
 
-void GlobalPlayer::update() {
-	move_functions.at(m_pattern)(m_sprites, m_ctx, [&](Id id) -> double { return hash(id + m_hash_offset); });
+	RoseKernel(Context *ctx) : t(ctx->t()), sprite_count(cfg[Cfg::SpriteCount]) { }
+
+	void move(Sprites *sprites, size_t i, Real offset, PatternState &) const {
+		double t = this->t - (offset * 0.03 * sprite_count);
+		double r = 0.04 * sprite_count * t;
 
-	for (Sprite *sprite : *m_sprites) {
-		sprite->update(*m_ctx);
+		Real target_x = cast<Real>(sin(r) * cos(t) * 0.8);
+		Real target_y = cast<Real>(sin(r) * sin(t) * 0.8);
+
+		sprites->home<X>(i) = target_x + (sprites->home<X>(i) - target_x) * Real(0.9);
+		sprites->home<Y>(i) = target_y + (sprites->home<Y>(i) - target_y) * Real(0.9);
 	}
-}
 
-std::set<PatternName> &GlobalPlayer::compatible_patterns() {
-	static std::set<PatternName> patterns = {
-		Bubbles
-	};
+	double t;
+	double sprite_count;
+};
 
-	return patterns;
-}
+struct LatticeKernel {
+	constexpr static PatternName NAME = Lattice;
+
+	LatticeKernel(Context *) { }
 
-std::map<PatternName, GlobalPlayer::MoveFunction> GlobalPlayer::move_functions {
-	{ Bubbles, [](Sprites *sprites, Context *ctx, std::function<double(Id)> get_offset) {
-		const static double SCREEN_SIZE = ctx->rect().bottom * ctx->rect().right;
-		const static double STRETCH_RATIO = (double) (ctx->rect().bottom) / ctx->rect().right;
-		const static double BUBBLE_Y_RADIUS = (10.0 / (cfg[Cfg::SpriteCount] / 1.5 + 40.0)) * std::pow(SCREEN_SIZE / (1080 * 1920) / 3.0 + 0.7, 1.1);
-		const static double BUBBLE_X_RADIUS = BUBBLE_Y_RADIUS * STRETCH_RATIO;
+	// The flocking of birds, the schooling of fish,
+	// The dancing of insects with a firefly's wish...
+	// There's beauty in movement, I must agree,
+	// But beauty in stillness, I also can see.
+	void move(Sprites *, size_t, Real, PatternState &) const { }
+};
 
-		static std::map<Id, Point> velocity;
+struct EddiesKernel {
+	constexpr static PatternName NAME = Eddies;
 
-		if (velocity.empty()) {
-			for (const Sprite *sprite : *sprites) {
-				double radians = Noise::random() * M_PI * 2;
-				double mag = Noise::random() + 0.4;
-				velocity[sprite->id()] = { std::cos(radians) * mag, std::sin(radians) * mag };
-			}
+	EddiesKernel(Context *ctx) : z(cast<Real>(ctx->t() * 0.1)) { }
+
+	// A river of noise, we ride on its curl;
+	// Turning its slope a quarter-way 'round,
+	// We never pile up, we just swirl and swirl,
+	// Forever in motion, and never aground.
+	void move(Sprites *sprites, size_t i, Real, PatternState &) const {
+		const Real scale = Real(1.5);
+		const Real speed = Real(1.2);
+
+		auto flow = PerlinNoise::get_gradient<Real>(sprites->home<X>(i) * scale, sprites->home<Y>(i) * scale, z);
+
+		sprites->home<X>(i) += per_frame(flow.dy * speed);
+		sprites->home<Y>(i) -= per_frame(flow.dx * speed);
+	}
+
+	Real z;
+};
+
+// A GlobalPlayer kernel moves everyone at once, since it needs to see everyone to do it.
+// offset(id) gives a sprite's offset, same as the single-pass kernels get; workers are
+// there for whatever part of it can be split up without changing the answer.
+struct BubblesKernel {
+	constexpr static PatternName NAME = Bubbles;
+
+	BubblesKernel(Context *ctx) : ctx(ctx) { }
+
+	void init(Sprites *sprites, PatternState &state) const {
+		for (std::vector<Real> &velocity : state.velocities) {
+			velocity.resize(sprites->size());
 		}
 
-		std::vector<std::pair<Sprite *, Sprite *>> collisions;
 		for (size_t i = 0; i < sprites->size(); i++) {
-			for (size_t j = 0; j < sprites->size(); j++) {
-				if (i == j) {
-					continue;
-				}
+			double radians = ctx->rng(RandomStream::Patterns).uniform() * M_PI * 2;
+			double mag = ctx->rng(RandomStream::Patterns).uniform() + 0.4;
+			state.velocities[X][i] = cast<Real>(std::cos(radians) * mag);
+			state.velocities[Y][i] = cast<Real>(std::sin(radians) * mag);
+		}
+	}
+
+	template <typename Offset> void move(Sprites *sprites, const Offset &, PatternState &state, WorkerPool &workers) const {
+		const Real STRETCH_RATIO = cast<Real>((double) (ctx->rect().bottom) / ctx->rect().right);
+		const Real BUBBLE_X_RADIUS = get<X>(bubble_radii(ctx));
 
-				Sprite *a = (*sprites)[i];
-				Sprite *b = (*sprites)[j];
+		std::array<std::vector<Real>, 2> &velocity = state.velocities;
 
-				double dist_x = a->final<X>() - b->final<X>();
-				double dist_y = (a->final<Y>() - b->final<Y>()) * STRETCH_RATIO;
-				double dist = std::sqrt(dist_x * dist_x + dist_y * dist_y);
+		// Nobody further than a cell away can be touching, so only the nine cells around each bubble need a look.
+		const Real radius_sq = BUBBLE_X_RADIUS * BUBBLE_X_RADIUS;
+		state.grid.build(sprites->size(), BUBBLE_X_RADIUS, BUBBLE_X_RADIUS / STRETCH_RATIO, [&](size_t i) {
+			return Point(sprites->final<X>(i), sprites->final<Y>(i));
+		});
 
-				if (dist < BUBBLE_X_RADIUS) {
-					collisions.push_back({ a, b });
+		// A bubble only ever changes its own velocity, and only reads everyone's positions,
+		// so each chunk of bubbles can bounce on its own; each gets its own list to fill.
+		size_t chunks = (sprites->size() + Sprites::CHUNK - 1) / Sprites::CHUNK;
+		if (state.collisions.size() < chunks) {
+			state.collisions.resize(chunks);
+		}
+
+		workers.run(sprites->size(), Sprites::CHUNK, [&](size_t first, size_t last) {
+			std::vector<size_t> &collisions = state.collisions[first / Sprites::CHUNK];
+			for (size_t a = first; a < last; a++) {
+				collisions.clear();
+				state.grid.visit_near(state.grid.x(a), state.grid.y(a), [&](size_t b, Real bx, Real by) {
+					Real dist_x = state.grid.x(a) - bx;
+					Real dist_y = (state.grid.y(a) - by) * STRETCH_RATIO;
+
+					if (b != a && dist_x * dist_x + dist_y * dist_y < radius_sq) {
+						collisions.push_back(b);
+					}
+				});
+
+				// Each bounce turns off the last one, so they go in store order, whichever cell they came from.
+				std::sort(collisions.begin(), collisions.end());
+
+				for (size_t b : collisions) {
+					Point L = { -velocity[X][a], -velocity[Y][a] };
+					Real mag_L = std::sqrt(get<X>(L) * get<X>(L) + get<Y>(L) * get<Y>(L));
+					Point L_u = { get<X>(L) / mag_L, get<Y>(L) / mag_L };
+
+					Point N = { sprites->final<X>(a) - sprites->final<X>(b), sprites->final<Y>(a) - sprites->final<Y>(b) };
+					Real mag_N = std::sqrt(get<X>(N) * get<X>(N) + get<Y>(N) * get<Y>(N));
+					get<X>(N) /= mag_N;
+					get<Y>(N) /= mag_N;
+
+					Real cos_theta = get<X>(L_u) * get<X>(N) + get<Y>(L_u) * get<Y>(N);
+				
+					if (cos_theta > 0) {
+						cos_theta *= std::signbit(get<X>(L) * get<Y>(N) - get<Y>(L) * get<X>(N)) ? Real(-1) : Real(1);
+
+						Real cos_theta_sq = cos_theta * cos_theta;
+						Real cos_2theta = 2 * cos_theta_sq - 1;
+
+						Real sin_theta = std::sqrt(1 - cos_theta_sq);
+						Real sin_2theta = (sin_theta + cos_theta) * (sin_theta + cos_theta) - 1;
+
+						Real Rx = get<X>(L) * cos_2theta - get<Y>(L) * sin_2theta;
+						Real Ry = get<X>(L) * sin_2theta + get<Y>(L) * cos_2theta;
+
+						velocity[X][a] = Rx;
+						velocity[Y][a] = Ry;
+					}
 				}
 			}
+		});
+
+		for (size_t i = 0; i < sprites->size(); i++) {
+			sprites->home<X>(i) += per_frame(velocity[X][i]) * Real(0.5);
+			sprites->home<Y>(i) += per_frame(velocity[Y][i]) / STRETCH_RATIO * Real(0.5);
 		}
+	}
 
-		for (const auto &collision : collisions) {
-			Sprite *a = collision.first;
-			Sprite *b = collision.second;
+	Context *ctx;
+};
 
-			Point L = { -get<X>(velocity[a->id()]), -get<Y>(velocity[a->id()]) };
-			double mag_L = std::sqrt(get<X>(L) * get<X>(L) + get<Y>(L) * get<Y>(L));
-			Point L_u = { get<X>(L) / mag_L, get<Y>(L) / mag_L };
+struct FlockKernel {
+	constexpr static PatternName NAME = Flock;
 
-			Point N = { a->final<X>() - b->final<X>(), a->final<Y>() - b->final<Y>() };
-			double mag_N = std::sqrt(get<X>(N) * get<X>(N) + get<Y>(N) * get<Y>(N));
-			get<X>(N) /= mag_N;
-			get<Y>(N) /= mag_N;
+	// How hard each urge pulls, against the others.
+	constexpr static Real SEPARATION = Real(2.5);
+	constexpr static Real ALIGNMENT = Real(1.0);
+	constexpr static Real COHESION = Real(0.6);
+	// Anyone closer than this share of the radius is too close for comfort.
+	constexpr static Real PERSONAL_SPACE = Real(0.35);
+	// How quickly a bird gives in to its urges, as a distance a whole time unit would take.
+	constexpr static double STEERING = 6.0;
+	constexpr static Real MIN_SPEED = Real(0.5);
 
-			double cos_theta = get<X>(L_u) * get<X>(N) + get<Y>(L_u) * get<Y>(N);
-			
-			if (cos_theta > 0) {
-				cos_theta *= std::signbit(get<X>(L) * get<Y>(N) - get<Y>(L) * get<X>(N)) ? -1.0 : 1.0;
+	FlockKernel(Context *ctx) : ctx(ctx) { }
 
-				double cos_theta_sq = cos_theta * cos_theta;
-				double cos_2theta = 2 * cos_theta_sq - 1;
+	void init(Sprites *sprites, PatternState &state) const {
+		for (std::vector<Real> &velocity : state.velocities) {
+			velocity.resize(sprites->size());
+		}
 
-				double sin_theta = std::sqrt(1 - cos_theta_sq);
-				double sin_2theta = (sin_theta + cos_theta) * (sin_theta + cos_theta) - 1;
+		for (size_t i = 0; i < sprites->size(); i++) {
+			double radians = ctx->rng(RandomStream::Patterns).uniform() * M_PI * 2;
+			state.velocities[X][i] = cast<Real>(std::cos(radians) * MIN_SPEED);
+			state.velocities[Y][i] = cast<Real>(std::sin(radians) * MIN_SPEED);
+		}
+	}
+
+	// Birds of a feather flock together,
+	// Keeping their distance, whatever the weather;
+	// Each one just follows the few that it sees,
+	// And yet the whole sky turns as one with the breeze.
+	template <typename Offset> void move(Sprites *sprites, const Offset &offset, PatternState &state, WorkerPool &workers) const {
+		const Real STRETCH_RATIO = cast<Real>((double) (ctx->rect().bottom) / ctx->rect().right);
+		// The more sprites there are, the closer together they start, and the less far each needs to look.
+		const double SPACING = 1.0 / std::sqrt(cfg[Cfg::SpriteCount]);
+		const Real RADIUS = cast<Real>(std::clamp(cfg[Cfg::FlockRadius], Cfg::FlockRadius.range.first, Cfg::FlockRadius.range.second) * SPACING);
+		const Real RADIUS_SQ = RADIUS * RADIUS;
+		const Real PERSONAL_RADIUS = RADIUS * PERSONAL_SPACE;
+		const Real PERSONAL_RADIUS_SQ = PERSONAL_RADIUS * PERSONAL_RADIUS;
+		const Real STEER = per_frame(STEERING);
+
+		std::array<std::vector<Real>, 2> &velocity = state.velocities;
+		std::array<std::vector<Real>, 2> &steered = state.steered;
+		for (std::vector<Real> &next : steered) {
+			next.resize(sprites->size());
+		}
 
-				double Rx = get<X>(L) * cos_2theta - get<Y>(L) * sin_2theta;
-				double Ry = get<X>(L) * sin_2theta + get<Y>(L) * cos_2theta;
+		// Like the bubbles, distances are measured in widths, so the radius is round on screen.
+		state.grid.build(sprites->size(), RADIUS, RADIUS / STRETCH_RATIO, [&](size_t i) {
+			return Point(sprites->home<X>(i), sprites->home<Y>(i));
+		});
+
+		// Everyone looks at where everyone was and how they were headed, and picks where
+		// they'll head next; nobody changes course until they all have, so any chunk can go first.
+		workers.run(sprites->size(), Sprites::CHUNK, [&](size_t first, size_t last) {
+			for (size_t a = first; a < last; a++) {
+				Real ax = state.grid.x(a);
+				Real ay = state.grid.y(a);
+
+				size_t neighbours = 0;
+				Real heading_x = 0, heading_y = 0;
+				Real centre_x = 0, centre_y = 0;
+				Real away_x = 0, away_y = 0;
+
+				state.grid.visit_near(ax, ay, [&](size_t b, Real bx, Real by) {
+					Real dist_x = bx - ax;
+					Real dist_y = (by - ay) * STRETCH_RATIO;
+					Real dist_sq = dist_x * dist_x + dist_y * dist_y;
+
+					if (b == a || !(dist_sq < RADIUS_SQ)) {
+						return;
+					}
+
+					neighbours++;
+					heading_x += velocity[X][b];
+					heading_y += velocity[Y][b];
+					centre_x += dist_x;
+					centre_y += dist_y;
+
+					// The closer they are, the harder the shove, fading to nothing at arm's length.
+					if (dist_sq < PERSONAL_RADIUS_SQ && dist_sq > 0) {
+						Real dist = std::sqrt(dist_sq);
+						Real shove = (PERSONAL_RADIUS - dist) / (PERSONAL_RADIUS * dist);
+						away_x -= dist_x * shove;
+						away_y -= dist_y * shove;
+					}
+				});
+
+				Real vx = velocity[X][a];
+				Real vy = velocity[Y][a];
+
+				if (neighbours > 0) {
+					Real n = cast<Real>(neighbours);
+					Real steer_x = (heading_x / n - vx) * ALIGNMENT + centre_x / (n * RADIUS) * COHESION + away_x * SEPARATION;
+					Real steer_y = (heading_y / n - vy) * ALIGNMENT + centre_y / (n * RADIUS) * COHESION + away_y * SEPARATION;
+					vx += steer_x * STEER;
+					vy += steer_y * STEER;
+				}
 
-				get<X>(velocity[a->id()]) = Rx;
-				get<Y>(velocity[a->id()]) = Ry;
+				// Some birds are just faster than others.
+				Real max_speed = Real(0.9) + offset(sprites->id(a)) * Real(0.4);
+				Real speed = std::sqrt(vx * vx + vy * vy);
+				if (speed > 0) {
+					Real clamped = std::clamp(speed, MIN_SPEED, max_speed);
+					vx *= clamped / speed;
+					vy *= clamped / speed;
+				}
+
+				steered[X][a] = vx;
+				steered[Y][a] = vy;
+			}
+		});
+
+		velocity.swap(steered);
+
+		workers.run(sprites->size(), Sprites::CHUNK, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				sprites->home<X>(i) += per_frame(velocity[X][i]) * Real(0.5);
+				sprites->home<Y>(i) += per_frame(velocity[Y][i]) / STRETCH_RATIO * Real(0.5);
 			}
+		});
+	}
+
+	Context *ctx;
+};
+
+struct OrbitKernel {
+	constexpr static PatternName NAME = Orbit;
+
+	// How hard everyone pulls on everyone else, all together.
+	constexpr static double GRAVITY = 0.5;
+	// Nobody gets pulled as if anyone were closer than this, so close calls don't fling them off screen.
+	constexpr static Real SOFTENING = Real(0.08);
+
+	OrbitKernel(Context *ctx) : ctx(ctx) { }
+
+	// Everyone sets off sideways, about as fast as whoever's further in would need them to
+	// go to circle round, so the whole crowd starts out turning like a galaxy.
+	void init(Sprites *sprites, PatternState &state) const {
+		const Real STRETCH_RATIO = cast<Real>((double) (ctx->rect().bottom) / ctx->rect().right);
+		size_t n = sprites->size();
+
+		for (std::vector<Real> &velocity : state.velocities) {
+			velocity.resize(n);
 		}
 
-		for (Sprite *sprite : *sprites) {
-			get<X>(sprite->home()) += get<X>(velocity[sprite->id()]) / cfg[Cfg::TimeDivisor] * 0.5;
-			get<Y>(sprite->home()) += get<Y>(velocity[sprite->id()]) / cfg[Cfg::TimeDivisor] / STRETCH_RATIO * 0.5;
-
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glColor4d(0.2, 0.2, 0.2, 1.0);
-			glBegin(GL_LINE_LOOP);
-			for (int i = 0; i < 20; i++) {
-				double theta = 2.0 * M_PI * i / 20.0;
-				double x = BUBBLE_X_RADIUS / 2 * std::cos(theta);
-				double y = BUBBLE_Y_RADIUS / 2 * std::sin(theta);
-				glVertex2d(x + sprite->final<X>(), y + sprite->final<Y>());
+		std::vector<Real> radii(n);
+		for (size_t i = 0; i < n; i++) {
+			radii[i] = std::hypot(sprites->home<X>(i), sprites->home<Y>(i) * STRETCH_RATIO);
+		}
+
+		std::vector<Real> sorted = radii;
+		std::sort(sorted.begin(), sorted.end());
+
+		for (size_t i = 0; i < n; i++) {
+			double r = radii[i];
+			double inside = cast<double>(std::lower_bound(sorted.begin(), sorted.end(), radii[i]) - sorted.begin()) / n;
+			double softened = r * r + SOFTENING * SOFTENING;
+			double speed = std::sqrt(GRAVITY * inside * r * r / (softened * std::sqrt(softened)));
+			speed *= 0.9 + ctx->rng(RandomStream::Patterns).uniform() * 0.2;
+
+			state.velocities[X][i] = r > 0 ? cast<Real>(-sprites->home<Y>(i) * STRETCH_RATIO / r * speed) : Real(0);
+			state.velocities[Y][i] = r > 0 ? cast<Real>(sprites->home<X>(i) / r * speed) : Real(0);
+		}
+	}
+
+	// Each of us pulls on the rest, and is pulled in return;
+	// Too many to count, but from far away, it's one,
+	// As a whole crowd that's distant, like a star, will burn,
+	// And we'll spin 'round each other till the night is done.
+	template <typename Offset> void move(Sprites *sprites, const Offset &, PatternState &state, WorkerPool &workers) const {
+		const Real STRETCH_RATIO = cast<Real>((double) (ctx->rect().bottom) / ctx->rect().right);
+		const Real OPENING_ANGLE = cast<Real>(std::clamp(cfg[Cfg::OrbitOpeningAngle], Cfg::OrbitOpeningAngle.range.first, Cfg::OrbitOpeningAngle.range.second));
+		// Everyone weighs the same, and all of them together weigh 1, however many there are.
+		const Real STRENGTH = cast<Real>(GRAVITY / (std::max)(sprites->size(), (size_t) 1));
+		const Real STEP = per_frame(1.0);
+
+		std::array<std::vector<Real>, 2> &velocity = state.velocities;
+
+		// Measured in widths, like the bubbles, so gravity pulls the same way up as it does across.
+		state.tree.build(sprites->size(), [&](size_t i) {
+			return Point(sprites->home<X>(i), sprites->home<Y>(i) * STRETCH_RATIO);
+		});
+
+		// The tree has its own copy of where everyone was, so everyone can move as soon as they've been pulled.
+		workers.run(sprites->size(), Sprites::CHUNK, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				QuadTree::Pull pull = state.tree.pull(state.tree.x(i), state.tree.y(i), OPENING_ANGLE, SOFTENING);
+
+				velocity[X][i] += pull.x * STRENGTH * STEP;
+				velocity[Y][i] += pull.y * STRENGTH * STEP;
+
+				sprites->home<X>(i) += velocity[X][i] * STEP;
+				sprites->home<Y>(i) += velocity[Y][i] * STEP / STRETCH_RATIO;
 			}
-			glEnd();
+		});
+	}
+
+	Context *ctx;
+};
+
+struct CurrentsKernel {
+	constexpr static PatternName NAME = Currents;
+
+	// Cells across; down is however many keeps them square on screen.
+	constexpr static int COLUMNS = 128;
+	// How many spoons are stirring the water, each on its own path, every other one the other way round.
+	constexpr static int STIRRERS = 3;
+	// How far a spoon reaches, in cells.
+	constexpr static float STIRRER_RADIUS = 16.0f;
+	// How hard a spoon turns the water, in cells per time unit per time unit.
+	constexpr static float SPIN = 150.0f;
+	// How much of its speed the water loses per time unit, so it settles instead of churning faster forever.
+	constexpr static float DECAY = 0.3f;
+
+	CurrentsKernel(Context *ctx) : ctx(ctx) { }
+
+	void init(Sprites *, PatternState &state) const {
+		const double STRETCH_RATIO = (double) (ctx->rect().bottom) / ctx->rect().right;
+		state.flow.resize(COLUMNS, std::clamp(cast<int>(std::lround(COLUMNS * STRETCH_RATIO)), 8, COLUMNS * 4));
+	}
+
+	// The spoons go 'round, and the water goes with;
+	// The water goes 'round, and we go where it goes;
+	// However many of us are caught in the drift,
+	// It's only the water that anyone knows.
+	template <typename Offset> void move(Sprites *sprites, const Offset &, PatternState &state, WorkerPool &workers) const {
+		FlowField &flow = state.flow;
+		const float STEP = cast<float>(per_frame(1.0));
+		const double t = ctx->t();
+
+		for (int k = 0; k < STIRRERS; k++) {
+			// Lissajous paths that never quite line up, so the spoons keep crossing each other's wakes.
+			double x = 0.5 + 0.35 * std::sin(t * (0.21 + 0.07 * k) + k * 2.1);
+			double y = 0.5 + 0.35 * std::sin(t * (0.17 + 0.05 * k) + k * 1.3);
+			float spin = k % 2 == 0 ? SPIN : -SPIN;
+			flow.stir(cast<float>(x * flow.width()), cast<float>(y * flow.height()), STIRRER_RADIUS, spin, STEP);
 		}
-	}},
+
+		flow.step(STEP, DECAY, workers);
+
+		// The grid's middles sit half a cell in from its edges, and the screen's [-1, 1] both ways.
+		const Real COLUMN_WIDTH = Real(2) / flow.width();
+		const Real ROW_HEIGHT = Real(2) / flow.height();
+
+		workers.run(sprites->size(), Sprites::CHUNK, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				float x = cast<float>((sprites->home<X>(i) + 1) / COLUMN_WIDTH - Real(0.5));
+				float y = cast<float>((sprites->home<Y>(i) + 1) / ROW_HEIGHT - Real(0.5));
+				FlowField::Flow current = flow.sample(x, y);
+
+				sprites->home<X>(i) += current.x * COLUMN_WIDTH * STEP;
+				sprites->home<Y>(i) += current.y * ROW_HEIGHT * STEP;
+			}
+		});
+	}
+
+	Context *ctx;
 };
+
+using SinglePassKernels = KernelList<
+	RoamersKernel,
+	WavesKernel,
+	SquareKernel,
+	BouncyKernel,
+	LissajousKernel,
+	RoseKernel,
+	LatticeKernel,
+	EddiesKernel
+>;
+
+using GlobalKernels = KernelList<
+	BubblesKernel,
+	FlockKernel,
+	OrbitKernel,
+	CurrentsKernel
+>;
+
+// Whichever kernel it is, if it keeps anything, it gets to set it up now.
+template <typename Kernel> static void init_state(const Kernel &kernel, Sprites *sprites, PatternState &state) {
+	if constexpr (requires { kernel.init(sprites, state); }) {
+		kernel.init(sprites, state);
+	}
+}
+
+SinglePassPlayer::SinglePassPlayer(Sprites *sprites, Context *ctx, WorkerPool *workers)
+	: PatternPlayer(sprites, ctx, workers) { }
+
+void SinglePassPlayer::update() {
+	{
+		StageClock::Scope timing(m_ctx->stages(), Stage::Patterns);
+
+		SinglePassKernels::dispatch(m_pattern, m_ctx, [&](const auto &kernel) {
+			// Each sprite only moves itself, and only touches its own state,
+			// so the crowd can be split up however.
+			m_workers->run(m_sprites->size(), Sprites::CHUNK, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++) {
+					kernel.move(m_sprites, i, hash(m_sprites->id(i) + m_hash_offset), m_state);
+				}
+			});
+		});
+	}
+
+	update_sprites();
+}
+
+void SinglePassPlayer::init_state() {
+	SinglePassKernels::dispatch(m_pattern, m_ctx, [&](const auto &kernel) {
+		::init_state(kernel, m_sprites, m_state);
+	});
+}
+ 
+std::set<PatternName> &SinglePassPlayer::compatible_patterns() {
+	static std::set<PatternName> patterns = SinglePassKernels::names();
+
+	return patterns;
+}
+
+GlobalPlayer::GlobalPlayer(Sprites *sprites, Context *ctx, WorkerPool *workers)
+	: PatternPlayer(sprites, ctx, workers) { }
+
+void GlobalPlayer::update() {
+	{
+		StageClock::Scope timing(m_ctx->stages(), Stage::Patterns);
+
+		GlobalKernels::dispatch(m_pattern, m_ctx, [&](const auto &kernel) {
+			kernel.move(m_sprites, [&](Id id) -> Real { return hash(id + m_hash_offset); }, m_state, *m_workers);
+		});
+	}
+
+	update_sprites();
+}
+
+void GlobalPlayer::init_state() {
+	GlobalKernels::dispatch(m_pattern, m_ctx, [&](const auto &kernel) {
+		::init_state(kernel, m_sprites, m_state);
+	});
+}
+
+std::set<PatternName> &GlobalPlayer::compatible_patterns() {
+	static std::set<PatternName> patterns = GlobalKernels::names();
+
+	return patterns;
+}
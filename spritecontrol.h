@@ -1,15 +1,21 @@
 #pragma once
 
+#include <memory>
 #include <vector>
-#include <functional>
 #include <cmath>
 
+#include "fluid.h"
 #include "graphics.h"
+#include "grid.h"
+#include "quadtree.h"
 #include "sprite.h"
+#include "workers.h"
 
+#ifndef M_PI
 const static double M_PI = std::acos(-1);
+#endif
 
-using Sprites = std::vector<Sprite *>;
+using Sprites = SpriteStore;
 
 enum PatternName {
 	Roamers,
@@ -20,12 +26,21 @@ enum PatternName {
 	Rose,
 	Lattice,
 	Bubbles,
+	Eddies,
+	Flock,
+	Orbit,
+	Currents,
 	_PATTERN_COUNT
 };
 
+// How far a bubble reaches across and down, on ctx's screen and for however many
+// sprites cfg asks for. Bubbles bounce off each other at this size, and Scene outlines them at it.
+Point bubble_radii(Context *ctx);
+
 class SpriteGenerator {
 public:
-	SpriteGenerator();
+	// Seeds ctx's streams from cfg, and draws everything it makes from them.
+	SpriteGenerator(Context *ctx);
 
 	Sprites make(unsigned int n) const;
 
@@ -33,57 +48,127 @@ private:
 	const Texture *next_texture() const;
 	const PaletteData *next_palette() const;
 
+	Bitmaps::Definition &random_impostor_bitmap() const;
+
+	Context *m_ctx;
 	std::vector<const PaletteData *> m_palettes;
 };
 
+// What the patterns remember from one frame to the next, besides where everyone is.
+// Each field has one entry per sprite, in store order, for the patterns that use it
+// and none for the ones that don't. It's wiped whenever a pattern starts over.
+struct PatternState {
+	// Bouncy: which way each sprite's headed.
+	std::vector<unsigned char> directions;
+	// Bubbles, Flock and Orbit: how fast each sprite's going, and where; Xs and Ys.
+	std::array<std::vector<Real>, 2> velocities;
+	// Flock: where everyone's heading next, before anyone's turned. Only kept for its memory.
+	std::array<std::vector<Real>, 2> steered;
+
+	// Bubbles and Flock: who's near whom. Bubbles: who one sprite is bumping into, one list
+	// per chunk of sprites. Both are worked out fresh every frame and never saved; they're
+	// only kept so their memory can be reused.
+	UniformGrid grid;
+	std::vector<std::vector<size_t>> collisions;
+	// Orbit: everyone's weight, split up into ever smaller pieces. Same as the grid, it's
+	// built fresh every frame and never saved.
+	QuadTree tree;
+
+	// Currents: the water everyone's floating in. It isn't per sprite; it's the one grid,
+	// however many there are, and it's carried on from frame to frame and saved with the rest.
+	FlowField flow;
+
+	void reset();
+};
+
 class PatternPlayer {
+	friend class SpriteChoreographer;
+
 public:
-	void set_pattern(PatternName pattern);
+	virtual ~PatternPlayer() = default;
+
+	// hash_offset reshuffles which sprite gets which offset, so no two patterns in a row line up the same.
+	void set_pattern(PatternName pattern, unsigned int hash_offset);
+
+	// What a player saved, read back and checked, but not taken in yet.
+	struct Saved {
+		PatternName pattern;
+		EmotionBatch emotions;
+		PatternState state;
+	};
+
+	void save(SnapshotWriter &snapshot) const;
+	// Reads what save() wrote into saved, for sprite_count sprites, and touches nothing here.
+	bool read(SnapshotReader &snapshot, size_t sprite_count, Saved &saved) const;
+	void apply(Saved &&saved);
 
 	virtual void update() = 0;
 	virtual std::set<PatternName> &compatible_patterns() = 0;
 
 protected:
-	PatternPlayer(Sprites *sprites, Context *ctx);
+	PatternPlayer(Sprites *sprites, Context *ctx, WorkerPool *workers);
+
+	void update_sprites();
+
+	// Sets up whatever the pattern keeps in its PatternState, before its first frame.
+	virtual void init_state() = 0;
 
-	static double hash(unsigned int n);
+	static Real hash(unsigned int n);
 
-	static unsigned int m_hash_offset;
+	unsigned int m_hash_offset;
 	PatternName m_pattern;
+	PatternState m_state;
 	Sprites *m_sprites;
 	Context *m_ctx;
+	WorkerPool *m_workers;
+	EmotionBatch m_emotions;
+	DriftBatch m_drift;
 };
 
 class SinglePassPlayer : public PatternPlayer {
 public:
-	SinglePassPlayer(Sprites *sprites, Context *ctx);
+	SinglePassPlayer(Sprites *sprites, Context *ctx, WorkerPool *workers);
 
 	void update() override;
 	std::set<PatternName> &compatible_patterns() override;
 
 protected:
-	using MoveFunction = std::function<void(Sprite *, Context *, double offset)>;
-	static std::map<PatternName, MoveFunction> move_functions;
+	void init_state() override;
 };
 
 class GlobalPlayer : public PatternPlayer {
 public:
-	GlobalPlayer(Sprites *sprites, Context *ctx);
+	GlobalPlayer(Sprites *sprites, Context *ctx, WorkerPool *workers);
 
 	void update() override;
 	std::set<PatternName> &compatible_patterns() override;
 
 protected:
-	using MoveFunction = std::function<void(Sprites *, Context *, std::function<double(Id)>)>;
-	static std::map<PatternName, MoveFunction> move_functions;
+	void init_state() override;
 };
 
 class SpriteChoreographer {
 public:
-	SpriteChoreographer(PatternName pattern, Sprites *sprites, Context *ctx);
+	SpriteChoreographer(PatternName pattern, Sprites *sprites, Context *ctx, WorkerPool *workers);
 
 	void update();
 
+	PatternName pattern() const;
+
+	// Which pattern's playing and everything the players are keeping track of, read
+	// back but not taken in yet.
+	struct Saved {
+		PatternName pattern;
+		unsigned int hash_offset;
+		std::vector<PatternPlayer::Saved> players;
+	};
+
+	void save(SnapshotWriter &snapshot) const;
+	// Same as the players': read() only reads and checks, for sprite_count sprites, so
+	// whoever's restoring can make sure the whole snapshot's good before apply() takes it in.
+	bool read(SnapshotReader &snapshot, size_t sprite_count, Saved &saved) const;
+	void apply(Saved &&saved);
+
 protected:
 	void change_pattern();
 	bool should_change_pattern();
@@ -92,7 +177,9 @@ protected:
 	Sprites *m_sprites;
 	Context *m_ctx;
 	PatternName m_pattern;
-	std::vector<PatternPlayer *> m_players;
+	unsigned int m_hash_offset;
+	std::vector<std::unique_ptr<PatternPlayer>> m_players;
+	// One of m_players.
 	PatternPlayer *m_current_player;
 };
 
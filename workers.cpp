@@ -0,0 +1,89 @@
+#include <algorithm>
+
+#include "workers.h"
+
+WorkerPool::WorkerPool(unsigned int threads) {
+	if (threads == 0) {
+		threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// The caller makes one, so it only needs to hire the rest.
+	for (unsigned int t = 1; t < threads; t++) {
+		m_threads.emplace_back(&WorkerPool::work_loop, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread &thread : m_threads) {
+		thread.join();
+	}
+}
+
+unsigned int WorkerPool::threads() const {
+	return (unsigned int) m_threads.size() + 1;
+}
+
+void WorkerPool::run(size_t n, size_t chunk, const std::function<void(size_t first, size_t last)> &work) {
+	chunk = (std::max)(chunk, (size_t) 1);
+
+	// Not worth waking anyone for.
+	if (m_threads.empty() || n <= chunk) {
+		for (size_t first = 0; first < n; first += chunk) {
+			work(first, (std::min)(first + chunk, n));
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_work = &work;
+		m_n = n;
+		m_chunk = chunk;
+		m_next_chunk = 0;
+		m_busy = (unsigned int) m_threads.size();
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	work_chunks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_busy == 0; });
+	m_work = nullptr;
+}
+
+void WorkerPool::work_loop() {
+	unsigned int seen = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+			if (m_stopping) {
+				return;
+			}
+			seen = m_generation;
+		}
+
+		work_chunks();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busy == 0) {
+			m_done.notify_one();
+		}
+	}
+}
+
+void WorkerPool::work_chunks() {
+	// Whoever's free takes the next chunk; which thread does which doesn't change what gets written.
+	for (size_t k = m_next_chunk++; k * m_chunk < m_n; k = m_next_chunk++) {
+		size_t first = k * m_chunk;
+		(*m_work)(first, (std::min)(first + m_chunk, m_n));
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A few threads to spread a pass over the sprites across.
+//
+// The work is always cut into the same chunks, whatever the thread count, and
+// with one thread they just run in order on the caller. So as long as each chunk
+// only writes to its own sprites, every thread count lands on the same bits.
+class WorkerPool {
+public:
+	// 1 keeps everything on the calling thread; 0 means one per core.
+	WorkerPool(unsigned int threads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &pool) = delete;
+	WorkerPool &operator=(const WorkerPool &pool) = delete;
+
+	unsigned int threads() const;
+
+	// Calls work(first, last) for every chunk of [0, n), chunk items at a time,
+	// and returns once they're all done. The caller pitches in too.
+	void run(size_t n, size_t chunk, const std::function<void(size_t first, size_t last)> &work);
+
+private:
+	void work_loop();
+	void work_chunks();
+
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	unsigned int m_generation = 0;
+	unsigned int m_busy = 0;
+	bool m_stopping = false;
+
+	const std::function<void(size_t first, size_t last)> *m_work = nullptr;
+	size_t m_n = 0;
+	size_t m_chunk = 0;
+	std::atomic<size_t> m_next_chunk = 0;
+};
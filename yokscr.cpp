@@ -12,7 +12,8 @@ name='Microsoft.Windows.Common-Controls' version='6.0.0.0' \
 processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 
 LRESULT WINAPI ScreenSaverProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam) {
-	static Scene *scene;
+	// Each window keeps its own scene, so there can be as many as there are windows.
+	Scene *scene = (Scene *) GetWindowLongPtr(window, GWLP_USERDATA);
 	
 	// Windows demands the most awkward of prose...
 	// Endless indenting and ceaseless macros.
@@ -22,15 +23,33 @@ LRESULT WINAPI ScreenSaverProc(HWND window, UINT message, WPARAM wparam, LPARAM
 	switch (message) {
 		case WM_CREATE: {
 			scene = new Scene(window);
+			SetWindowLongPtr(window, GWLP_USERDATA, (LONG_PTR) scene);
 			scene->draw_background();
 			return 0;
 		}
 		case WM_DESTROY: {
+			SetWindowLongPtr(window, GWLP_USERDATA, 0);
 			delete scene;
 			return 0;
 		}
+		case WM_PAINT: {
+			PAINTSTRUCT paint;
+			BeginPaint(window, &paint);
+			EndPaint(window, &paint);
+
+			// With vsync, every frame asks for the next as soon as it's drawn, and SwapBuffers
+			// holds it to the display's refresh rate, 60 Hz or 144. Windows only sends WM_PAINT
+			// once there's nothing else waiting, so the input that ends us always gets through.
+			if (scene != nullptr && scene->vsync()) {
+				scene->draw();
+				InvalidateRect(window, NULL, FALSE);
+			}
+			return 0;
+		}
 		case WM_TIMER: {
-			scene->draw();
+			if (scene != nullptr) {
+				scene->draw();
+			}
 			return 0;
 		}
 	}